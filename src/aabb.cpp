@@ -0,0 +1,10 @@
+#include <limits>
+#include "aabb.h"
+
+// Built from fresh intervals rather than interval::empty and
+// interval::universe, which live in other translation units and may not
+// have been initialized yet.
+static const real inf = std::numeric_limits<real>::infinity();
+
+const aabb aabb::empty    = aabb(interval(inf, -inf), interval(inf, -inf), interval(inf, -inf));
+const aabb aabb::universe = aabb(interval(-inf, inf), interval(-inf, inf), interval(-inf, inf));
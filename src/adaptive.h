@@ -0,0 +1,148 @@
+#ifndef ADAPTIVEH
+#define ADAPTIVEH
+
+#include <cmath>
+#include <vector>
+#include "random.h"
+#include "tile_renderer.h"
+#include "vec3.h"
+
+// Running estimate of one pixel. The colour mean is accumulated directly;
+// the variance is tracked on luminance with Welford's method, which stays
+// accurate without keeping the samples.
+struct pixel_estimate {
+    vec3 mean = vec3(0, 0, 0);
+    double lum_mean = 0;
+    double lum_m2 = 0;
+    int n = 0;
+
+    void add(const vec3& c) {
+        n++;
+        mean += (c - mean) / float(n);
+        double lum = 0.2126*c[0] + 0.7152*c[1] + 0.0722*c[2];
+        double delta = lum - lum_mean;
+        lum_mean += delta / n;
+        lum_m2 += delta * (lum - lum_mean);
+    }
+
+    double variance() const {
+        return n > 1 ? lum_m2 / (n - 1) : 0;
+    }
+
+    // Half width of the 95% confidence interval of the luminance mean,
+    // measured after the gamma 2 transform the image is written with:
+    // d(sqrt(L)) = dL / (2 sqrt(L)). Very dark pixels use a floor so a few
+    // stray bright samples don't look infinitely noisy.
+    double error() const {
+        if (n < 2)
+            return INFINITY;
+        double half_width = 1.96 * std::sqrt(variance() / n);
+        return half_width / (2 * std::sqrt(std::fmax(lum_mean, 1e-2)));
+    }
+};
+
+// Maps t in [0, 1] to black, red, yellow, white for sample count heat maps.
+inline vec3 heat_color(double t) {
+    t = std::fmin(std::fmax(t, 0.0), 1.0) * 3;
+    return vec3(std::fmin(t, 1.0), std::fmin(std::fmax(t - 1, 0.0), 1.0), std::fmax(t - 2, 0.0));
+}
+
+struct adaptive_settings {
+    int min_samples = 16;   // every pixel takes at least this many
+    int batch = 8;          // samples taken between convergence checks
+    int max_samples = 4096; // hard cap for any one pixel
+    double threshold = 0.01; // stop once error() is below this
+};
+
+// Spends a fixed total sample budget unevenly. First every pixel samples in
+// batches until its error drops below the threshold, or until it has used
+// its even share of the budget. Then the samples saved on converged pixels
+// go to the ones still above the threshold, in proportion to how many more
+// each needs (n * (error / threshold)^2 - n), over a few rounds.
+//
+// Each pixel has its own RNG stream that persists across rounds, so the
+// result is the same for any thread count.
+class adaptive_sampler {
+    public:
+        adaptive_sampler(int nx, int ny, const adaptive_settings& settings = adaptive_settings())
+            : nx(nx), ny(ny), settings(settings), pixels(nx*ny), rngs(nx*ny) {}
+
+        // sample(i, j) returns the radiance of one new sample of pixel (i, j),
+        // drawing its random numbers from random_double().
+        template <typename Sampler>
+        void render(Sampler sample, const tile_renderer& renderer, int samples_per_pixel, uint64_t seed) {
+            for (int j = 0; j < ny; j++)
+                for (int i = 0; i < nx; i++)
+                    rngs[j*nx + i] = make_rng(pixel_seed(seed, i, j));
+
+            long budget = long(samples_per_pixel) * nx * ny;
+            std::vector<int> target(nx*ny, samples_per_pixel);
+            run(sample, renderer, target);
+
+            for (int round = 0; round < 4; round++) {
+                long spare = budget - total_samples();
+                if (spare < settings.batch)
+                    break;
+
+                double wanted = 0;
+                std::vector<double> want(nx*ny, 0);
+                for (int p = 0; p < nx*ny; p++) {
+                    const pixel_estimate& e = pixels[p];
+                    if (e.error() <= settings.threshold || e.n >= settings.max_samples)
+                        continue;
+                    double ratio = e.error() / settings.threshold;
+                    want[p] = std::fmin(e.n * (ratio*ratio - 1), settings.max_samples - e.n);
+                    wanted += want[p];
+                }
+                if (wanted < 1)
+                    break;
+
+                double scale = wanted > spare ? spare / wanted : 1;
+                for (int p = 0; p < nx*ny; p++)
+                    target[p] = pixels[p].n + int(want[p] * scale);
+                run(sample, renderer, target);
+            }
+        }
+
+        long total_samples() const {
+            long n = 0;
+            for (const pixel_estimate& e : pixels)
+                n += e.n;
+            return n;
+        }
+
+        const pixel_estimate& pixel(int i, int j) const { return pixels[j*nx + i]; }
+
+        int nx, ny;
+        adaptive_settings settings;
+
+    private:
+        // Samples every pixel in batches until it converges or reaches
+        // target[p] samples.
+        template <typename Sampler>
+        void run(Sampler& sample, const tile_renderer& renderer, const std::vector<int>& target) {
+            renderer.render_tiles([&](const tile& t) {
+                rng_state& thread_rng = random_state();
+                for (int j = t.y0; j < t.y1; j++) {
+                    for (int i = t.x0; i < t.x1; i++) {
+                        int p = j*nx + i;
+                        pixel_estimate& e = pixels[p];
+                        thread_rng = rngs[p];
+                        while (e.n < target[p]) {
+                            if (e.n >= settings.min_samples && e.error() <= settings.threshold)
+                                break;
+                            int end = std::min(e.n + settings.batch, target[p]);
+                            while (e.n < end)
+                                e.add(sample(i, j));
+                        }
+                        rngs[p] = thread_rng;
+                    }
+                }
+            });
+        }
+
+        std::vector<pixel_estimate> pixels;
+        std::vector<rng_state> rngs;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef ALIGNEDH
+#define ALIGNEDH
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// std::allocator that hands out memory aligned to Align bytes, so SIMD
+// kernels can use aligned loads on std::vector storage.
+template <typename T, std::size_t Align = 64>
+struct aligned_allocator {
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind { typedef aligned_allocator<U, Align> other; };
+
+    aligned_allocator() {}
+    template <typename U>
+    aligned_allocator(const aligned_allocator<U, Align>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+    }
+
+    void deallocate(T* p, std::size_t) {
+        ::operator delete(p, std::align_val_t(Align));
+    }
+
+    template <typename U>
+    bool operator==(const aligned_allocator<U, Align>&) const { return true; }
+    template <typename U>
+    bool operator!=(const aligned_allocator<U, Align>&) const { return false; }
+};
+
+template <typename T, std::size_t Align = 64>
+using aligned_vector = std::vector<T, aligned_allocator<T, Align>>;
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef ARENAH
+#define ARENAH
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for objects that live as long as a scene. Objects are
+// carved out of large blocks one after another, so things built together
+// sit together in memory and a scene of any size costs a handful of
+// allocations. Nothing is freed individually; destroying the arena runs
+// the destructors that need running, newest first, then frees the blocks.
+class arena {
+    public:
+        arena(size_t block_size = 1 << 20) : block_size(block_size), cur(nullptr), end(nullptr) {}
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        ~arena() {
+            for (size_t k = cleanups.size(); k-- > 0; )
+                cleanups[k].destroy(cleanups[k].object);
+            for (char* b : blocks)
+                ::operator delete(b);
+        }
+
+        void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+            uintptr_t p = (reinterpret_cast<uintptr_t>(cur) + align - 1) & ~uintptr_t(align - 1);
+            if (cur == nullptr || p + size > reinterpret_cast<uintptr_t>(end)) {
+                // Oversized requests get a block of their own.
+                size_t n = size + align > block_size ? size + align : block_size;
+                char* b = static_cast<char*>(::operator new(n));
+                blocks.push_back(b);
+                cur = b;
+                end = b + n;
+                p = (reinterpret_cast<uintptr_t>(cur) + align - 1) & ~uintptr_t(align - 1);
+            }
+            cur = reinterpret_cast<char*>(p + size);
+            return reinterpret_cast<void*>(p);
+        }
+
+        template <typename T, typename... Args>
+        T* make(Args&&... args) {
+            T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if (!std::is_trivially_destructible<T>::value)
+                cleanups.push_back({ object, [](void* o) { static_cast<T*>(o)->~T(); } });
+            return object;
+        }
+
+        // n default constructed Ts in one contiguous run.
+        template <typename T>
+        T* make_array(size_t n) {
+            T* objects = static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+            for (size_t k = 0; k < n; k++)
+                new (objects + k) T();
+            if (!std::is_trivially_destructible<T>::value) {
+                for (size_t k = 0; k < n; k++)
+                    cleanups.push_back({ objects + k, [](void* o) { static_cast<T*>(o)->~T(); } });
+            }
+            return objects;
+        }
+
+        size_t block_count() const { return blocks.size(); }
+
+    private:
+        struct cleanup {
+            void* object;
+            void (*destroy)(void*);
+        };
+
+        size_t block_size;
+        char* cur;
+        char* end;
+        std::vector<char*> blocks;
+        std::vector<cleanup> cleanups;
+};
+
+#endif
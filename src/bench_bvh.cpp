@@ -0,0 +1,78 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include "bvh.h"
+#include "linear_bvh.h"
+#include "scenes.h"
+using namespace std;
+
+// Rays/sec of hitable_list, the pointer based bvh_node and the flattened
+// linear_bvh on random_scene() as the sphere count grows, up to ~100k
+// spheres. The list is skipped on the big scenes where it would take
+// minutes. Rays start at random points above the grid and point in random
+// directions, so they sample the whole scene rather than one view.
+
+vector<ray> make_rays(int extent, int n) {
+    vector<ray> rays(n);
+    for (int i = 0; i < n; i++) {
+        vec3 origin((2*random_double() - 1)*extent, 0.5 + 2*random_double(), (2*random_double() - 1)*extent);
+        vec3 dir;
+        do {
+            dir = 2.0*vec3(random_double(), random_double(), random_double()) - vec3(1, 1, 1);
+        } while (dir.squared_length() >= 1.0);
+        rays[i] = ray(origin, dir);
+    }
+    return rays;
+}
+
+// Traces the rays repeatedly until at least min_seconds have passed.
+double rays_per_sec(const hitable *world, const vector<ray>& rays, int& hits, double min_seconds = 0.5) {
+    long traced = 0;
+    double elapsed = 0;
+    auto start = chrono::steady_clock::now();
+    do {
+        hits = 0;
+        for (const ray& r : rays) {
+            hit_record rec;
+            if (world->hit(r, 0.001, MAXFLOAT, rec))
+                hits++;
+        }
+        traced += rays.size();
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (elapsed < min_seconds);
+    return traced / elapsed;
+}
+
+int main() {
+    cout << "spheres  list rays/s  bvh rays/s  linear_bvh rays/s  linear/bvh  bvh build ms  linear build ms\n";
+    for (int extent : { 5, 11, 25, 50, 100, 158 }) {
+        hitable_list *scene = random_scene(extent);
+
+        auto start = chrono::steady_clock::now();
+        bvh_node *bvh = new bvh_node(scene->list, scene->list_size);
+        double bvh_build_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        linear_bvh *lbvh = new linear_bvh(scene->list, scene->list_size);
+        double lbvh_build_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        vector<ray> rays = make_rays(extent, 10000);
+        int list_hits = -1, bvh_hits, lbvh_hits;
+        double list_rate = 0;
+        if (scene->list_size <= 12000)
+            list_rate = rays_per_sec(scene, rays, list_hits);
+        double bvh_rate = rays_per_sec(bvh, rays, bvh_hits);
+        double lbvh_rate = rays_per_sec(lbvh, rays, lbvh_hits);
+        if ((list_hits >= 0 && list_hits != bvh_hits) || lbvh_hits != bvh_hits)
+            cerr << "hit count mismatch: list " << list_hits << ", bvh " << bvh_hits
+                 << ", linear_bvh " << lbvh_hits << "\n";
+
+        cout << scene->list_size << "  ";
+        if (list_hits >= 0)
+            cout << list_rate;
+        else
+            cout << "-";
+        cout << "  " << bvh_rate << "  " << lbvh_rate << "  " << lbvh_rate / bvh_rate << "x  "
+             << bvh_build_ms << "  " << lbvh_build_ms << "\n";
+    }
+}
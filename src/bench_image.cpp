@@ -0,0 +1,57 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include "image.h"
+using namespace std;
+
+// Time and size of writing a 3840x2160 frame: the old per-pixel ASCII
+// ofstream loop the renderers used, and each format write_image() offers.
+
+const int nx = 3840, ny = 2160;
+
+long file_size(const char* path) {
+    ifstream in(path, ios::binary | ios::ate);
+    return long(in.tellg());
+}
+
+template <typename F>
+void report(const char* name, const char* path, F write) {
+    auto start = chrono::steady_clock::now();
+    write();
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << name << ms << " ms, " << file_size(path) / 1024 << " KiB\n";
+    remove(path);
+}
+
+int main() {
+    // A smooth gradient with a little noise, roughly what a render looks like.
+    image img(nx, ny);
+    uint32_t state = 1;
+    for (int j = 0; j < ny; j++)
+        for (int i = 0; i < nx; i++) {
+            state = state * 1664525u + 1013904223u;
+            float noise = (state >> 8) / float(1 << 24) * 0.05f;
+            img.at(i, j) = vec3(float(i) / nx + noise, float(j) / ny + noise, 0.25f + noise);
+        }
+
+    report("ofstream P3:  ", "bench_image.ppm", [&]() {
+        ofstream out("bench_image.ppm");
+        out << "P3\n" << nx << " " << ny << "\n255\n";
+        for (int j = ny-1; j >= 0; j--)
+            for (int i = 0; i < nx; i++) {
+                vec3 col = img.at(i, j);
+                col = vec3(sqrt(col[0]), sqrt(col[1]), sqrt(col[2]));
+                int ir = int(255.99*col[0]);
+                int ig = int(255.99*col[1]);
+                int ib = int(255.99*col[2]);
+                out << ir << " " << ig << " " << ib << "\n";
+            }
+    });
+    report("image P3:     ", "bench_image.ppm", [&]() { write_image("bench_image.ppm", img, IMAGE_PPM_ASCII); });
+    report("image P6:     ", "bench_image.ppm", [&]() { write_image("bench_image.ppm", img, IMAGE_PPM); });
+    report("image P6 16:  ", "bench_image.ppm", [&]() { write_image("bench_image.ppm", img, IMAGE_PPM16); });
+    report("image PFM:    ", "bench_image.pfm", [&]() { write_image("bench_image.pfm", img, IMAGE_PFM); });
+    report("image PNG:    ", "bench_image.png", [&]() { write_image("bench_image.png", img, IMAGE_PNG); });
+    report("image PNG 16: ", "bench_image.png", [&]() { write_image("bench_image.png", img, IMAGE_PNG16); });
+}
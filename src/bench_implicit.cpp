@@ -0,0 +1,74 @@
+#include <iostream>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+#include "implicit.h"
+#include "random.h"
+using namespace std;
+
+// Rays/sec against a torus with each root finder: the closed-form quartic
+// (Ferrari, polished with a Newton step) and derivative bracketing. Each
+// hit is also measured against the torus's exact distance function, and
+// the two finders are checked to agree on which rays hit.
+
+vector<ray> make_rays(int n) {
+    vector<ray> rays(n);
+    for (int i = 0; i < n; i++) {
+        vec3 origin(8*random_double() - 4, 8*random_double() - 4, 8*random_double() - 4);
+        vec3 target(3*random_double() - 1.5, random_double() - 0.5, 3*random_double() - 1.5);
+        rays[i] = ray(origin, target - origin);
+    }
+    return rays;
+}
+
+// Distance from p to the surface of t.
+double torus_distance(const torus& t, const vec3& p) {
+    vec3 o = p - t.center;
+    double ring = sqrt(double(o[0])*o[0] + double(o[2])*o[2]) - t.major;
+    return fabs(sqrt(ring*ring + double(o[1])*o[1]) - t.minor);
+}
+
+int main() {
+    torus shape(vec3(0, 0, 0), 1, 0.35, 0);
+    vector<ray> rays = make_rays(200000);
+    struct finder { const char* name; polynomial_root_fn fn; };
+    finder finders[] = { { "closed form", first_root_closed_form }, { "bracketing", first_root_bracketed } };
+
+    vector<char> hits[2];
+    for (int f = 0; f < 2; f++) {
+        implicit_surface::solver = finders[f].fn;
+        hits[f].resize(rays.size());
+        double worst = 0;
+        int count = 0;
+        for (size_t k = 0; k < rays.size(); k++) {
+            hit_record rec;
+            hits[f][k] = shape.hit(rays[k], 0.001, FLT_MAX, rec);
+            if (hits[f][k]) {
+                count++;
+                worst = max(worst, torus_distance(shape, rec.p) / shape.minor);
+            }
+        }
+
+        long traced = 0, sink = 0;
+        double elapsed = 0;
+        auto start = chrono::steady_clock::now();
+        do {
+            for (const ray& r : rays) {
+                hit_record rec;
+                sink += shape.hit(r, 0.001, FLT_MAX, rec);
+            }
+            traced += rays.size();
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < 0.5);
+        if (sink < 0)
+            cout << sink;
+        printf("%-12s %6.2f Mrays/s, %5.1f%% hit, worst distance from the surface %.2g minor radii\n",
+               finders[f].name, traced / elapsed / 1e6, 100.0 * count / rays.size(), worst);
+    }
+
+    int disagree = 0;
+    for (size_t k = 0; k < rays.size(); k++)
+        disagree += hits[0][k] != hits[1][k];
+    printf("rays the two disagree on: %d of %zu\n", disagree, rays.size());
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <unistd.h>
+#include "camera.h"
+#include "instance.h"
+#include "linear_bvh.h"
+#include "random.h"
+#include "scenes.h"
+#include "triangle_mesh.h"
+using namespace std;
+
+// random_scene() against instanced_scene() at the given extent (default
+// 500, about a million objects): the memory each takes with its top-level
+// BVH, the time to build that BVH, and camera rays per second through it.
+// First, an instanced unit sphere is checked against the sphere it
+// stands in for.
+
+double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Resident set size in MiB.
+double resident_mib() {
+    long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        fclose(f);
+    }
+    return resident * double(sysconf(_SC_PAGESIZE)) / (1 << 20);
+}
+
+void measure(const char* name, scene* (*make)(int), int extent) {
+    double before = resident_mib();
+    seed_random(1);
+    auto start = chrono::steady_clock::now();
+    scene* world = make(extent);
+    double scene_s = seconds_since(start);
+    start = chrono::steady_clock::now();
+    linear_bvh* bvh = new linear_bvh(world->list, world->list_size);
+    double bvh_s = seconds_since(start);
+    double used = resident_mib() - before;
+
+    const int nx = 512, ny = 256;
+    camera cam(vec3(13,2,3), vec3(0,0,0), vec3(0,1,0), 20, float(nx)/float(ny));
+    hit_record rec;
+    int hits = 0;
+    start = chrono::steady_clock::now();
+    for (int j = 0; j < ny; j++)
+        for (int i = 0; i < nx; i++)
+            hits += bvh->hit(cam.get_ray(real(i + 0.5)/nx, real(j + 0.5)/ny), 0.001, FLT_MAX, rec);
+    double trace_s = seconds_since(start);
+
+    printf("%-16s %8d objects  %5d materials  %8.1f MiB (%5.1f bytes/object)  scene %6.0f ms  bvh %6.0f ms  %5.2f Mrays/s (%d hits)\n",
+           name, world->list_size, world->materials.size(), used, used * (1 << 20) / world->list_size,
+           scene_s * 1000, bvh_s * 1000, nx*ny / trace_s / 1e6, hits);
+    delete bvh;
+    delete world;
+}
+
+int main(int argc, char** argv) {
+    int extent = argc > 1 ? atoi(argv[1]) : 500;
+
+    // An instance of the unit sphere, moved, turned and scaled, must hit
+    // where the equivalent sphere does.
+    sphere unit(vec3(0, 0, 0), 1, 0);
+    int mismatches = 0;
+    double worst_t = 0, worst_normal = 0;
+    seed_random(7);
+    for (int k = 0; k < 100000; k++) {
+        vec3 center(10*random_double() - 5, 10*random_double() - 5, 10*random_double() - 5);
+        real radius = 0.1 + 2*random_double();
+        instance placed(&unit, affine_transform::translation(center)
+                             * affine_transform::rotation_y(360*random_double())
+                             * affine_transform::scaling(radius));
+        sphere direct(center, radius, 0);
+        vec3 from(20*random_double() - 10, 20*random_double() - 10, 20*random_double() - 10);
+        vec3 to = center + radius*vec3(random_double() - 0.5, random_double() - 0.5, random_double() - 0.5);
+        ray r(from, to - from);
+        hit_record a, b;
+        bool ha = placed.hit(r, 0.001, FLT_MAX, a), hb = direct.hit(r, 0.001, FLT_MAX, b);
+        if (ha != hb) {
+            mismatches++;
+        } else if (ha) {
+            worst_t = max(worst_t, double(fabs(a.t - b.t) / b.t));
+            worst_normal = max(worst_normal, double((a.normal - b.normal).length()));
+        }
+    }
+    printf("instanced sphere vs sphere: %d hit/miss mismatches in 100000 rays, worst relative t error %.2g, "
+           "worst normal error %.2g\n", mismatches, worst_t, worst_normal);
+    printf("sizeof(sphere) %zu, sizeof(instance) %zu\n", sizeof(sphere), sizeof(instance));
+
+    measure("random_scene", random_scene, extent);
+    measure("instanced_scene", instanced_scene, extent);
+
+    // What the instanced scene would cost with every mesh copied out.
+    vector<vec3> vertices;
+    vector<int32_t> indices;
+    sphere_mesh(vec3(0, 0, 0), 1, 32, 16, vertices, indices);
+    size_t smooth = indices.size() / 3;
+    sphere_mesh(vec3(0, 0, 0), 1, 6, 3, vertices, indices);
+    size_t faceted = indices.size() / 3;
+    double copies = 4.0 * extent * extent;
+    printf("flattened, the instanced scene would hold about %.0f million triangles\n",
+           copies * (smooth + faceted) / 2 / 1e6);
+    return mismatches > 10 ? 1 : 0;
+}
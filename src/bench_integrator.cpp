@@ -0,0 +1,73 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include "linear_bvh.h"
+#include "scenes.h"
+#include "wavefront.h"
+using namespace std;
+
+// Samples/sec of the recursive color(), the iterative one and the wavefront
+// integrator on ch5's view of random_scene(), single threaded.
+
+const int nx = 200, ny = 100, ns = 16;
+
+template <typename F>
+double samples_per_sec(const char* name, F render) {
+    auto start = chrono::steady_clock::now();
+    vec3 sum = render();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double rate = double(nx)*ny*ns / secs;
+    cout << name << rate << " samples/s  (mean radiance " << sum / float(nx*ny*ns) << ")\n";
+    return rate;
+}
+
+int main() {
+    scene *objects = random_scene();
+    linear_bvh world(objects->list, objects->list_size);
+    const material_table& materials = objects->materials;
+    camera cam(vec3(-2,2,1), vec3(0,0,-1), vec3(0,1,0), 90, float(nx)/float(ny));
+    uint64_t seed = 1;
+
+    double recursive = samples_per_sec("recursive: ", [&]() {
+        vec3 sum(0, 0, 0);
+        for (int j = 0; j < ny; j++)
+            for (int i = 0; i < nx; i++) {
+                seed_random(pixel_seed(seed, i, j));
+                for (int s = 0; s < ns; s++)
+                    sum += color_recursive(cam.get_ray(float(i + random_double()) / float(nx),
+                                                       float(j + random_double()) / float(ny)), &world, materials, 0);
+            }
+        return sum;
+    });
+
+    double iterative = samples_per_sec("iterative: ", [&]() {
+        vec3 sum(0, 0, 0);
+        for (int j = 0; j < ny; j++)
+            for (int i = 0; i < nx; i++) {
+                seed_random(pixel_seed(seed, i, j));
+                for (int s = 0; s < ns; s++)
+                    sum += color(cam.get_ray(float(i + random_double()) / float(nx),
+                                             float(j + random_double()) / float(ny)), &world, materials);
+            }
+        return sum;
+    });
+
+    // Wavefront batches are 16x16 pixel tiles, as ch5 -wavefront uses.
+    double wavefront = samples_per_sec("wavefront: ", [&]() {
+        vec3 sum(0, 0, 0);
+        wavefront_integrator integrator(&world, materials);
+        for (int y = 0; y < ny; y += 16)
+            for (int x = 0; x < nx; x += 16) {
+                tile t = { x, y, min(x + 16, nx), min(y + 16, ny) };
+                vector<vec3> radiance((t.x1 - t.x0)*(t.y1 - t.y0), vec3(0, 0, 0));
+                vector<wavefront_path> paths = camera_paths(cam, t, nx, ny, ns, seed);
+                integrator.trace(paths, radiance.data());
+                for (const vec3& c : radiance)
+                    sum += c;
+            }
+        return sum;
+    });
+
+    cout << "iterative/recursive " << iterative / recursive
+         << "x, wavefront/recursive " << wavefront / recursive << "x\n";
+}
@@ -0,0 +1,158 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "camera.h"
+#include "integrator.h"
+#include "linear_bvh.h"
+#include "scenes.h"
+using namespace std;
+
+// Throughput of the shading stage alone: scattering a fixed set of hits
+// recorded from ch5's view of random_scene() (camera hits and their first
+// bounce). Compares the old virtual material classes, each new'd on its own
+// and reached through a pointer, with the tagged materials dispatched by a
+// switch, and with the hits bucketed by type first so each bucket calls its
+// scatter function directly, as the wavefront integrator does.
+
+const int nx = 400, ny = 200, spp = 4;
+
+// The virtual interface materials used to have, sharing the scatter code so
+// only the dispatch differs.
+class virtual_material {
+    public:
+        virtual_material(const material& m) : m(m) {}
+        virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const = 0;
+        material m;
+};
+
+class virtual_lambertian : public virtual_material {
+    public:
+        using virtual_material::virtual_material;
+        virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const {
+            return lambertian_scatter(m, r_in, rec, attenuation, scattered);
+        }
+};
+
+class virtual_metal : public virtual_material {
+    public:
+        using virtual_material::virtual_material;
+        virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const {
+            return metal_scatter(m, r_in, rec, attenuation, scattered);
+        }
+};
+
+class virtual_dielectric : public virtual_material {
+    public:
+        using virtual_material::virtual_material;
+        virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const {
+            return dielectric_scatter(m, r_in, rec, attenuation, scattered);
+        }
+};
+
+struct shading_hit {
+    ray r;
+    hit_record rec;
+    virtual_material* mat_ptr;
+};
+
+// Runs shade over every hit until min_seconds have passed and reports the
+// best hits/sec. The RNG is reseeded each pass so all variants draw the
+// same numbers; the sum of the scattered directions shows they agree.
+template <typename Shade>
+double hits_per_sec(const char* name, size_t n, Shade shade, double min_seconds = 0.5) {
+    double best = 0, elapsed = 0;
+    vec3 sum;
+    auto start = chrono::steady_clock::now();
+    do {
+        seed_random(7);
+        auto pass_start = chrono::steady_clock::now();
+        sum = shade();
+        auto now = chrono::steady_clock::now();
+        best = max(best, n / chrono::duration<double>(now - pass_start).count());
+        elapsed = chrono::duration<double>(now - start).count();
+    } while (elapsed < min_seconds);
+    cout << name << best / 1e6 << "M hits/s  (direction sum " << sum << ")\n";
+    return best;
+}
+
+int main() {
+    scene *objects = random_scene();
+    linear_bvh world(objects->list, objects->list_size);
+    const material_table& materials = objects->materials;
+    camera cam(vec3(-2,2,1), vec3(0,0,-1), vec3(0,1,0), 90, float(nx)/float(ny));
+
+    vector<virtual_material*> virtual_materials;
+    for (int id = 0; id < materials.size(); id++) {
+        const material& m = materials[id];
+        if (m.type == MAT_LAMBERTIAN)  virtual_materials.push_back(new virtual_lambertian(m));
+        else if (m.type == MAT_METAL)  virtual_materials.push_back(new virtual_metal(m));
+        else                           virtual_materials.push_back(new virtual_dielectric(m));
+    }
+
+    vector<shading_hit> hits;
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            for (int s = 0; s < spp; s++) {
+                shading_hit h;
+                h.r = cam.get_ray(float(i + random_double()) / float(nx), float(j + random_double()) / float(ny));
+                for (int bounce = 0; bounce < 2 && world.hit(h.r, 0.001, MAXFLOAT, h.rec); bounce++) {
+                    h.mat_ptr = virtual_materials[h.rec.mat_id];
+                    hits.push_back(h);
+                    vec3 attenuation;
+                    if (!scatter(materials[h.rec.mat_id], h.r, h.rec, attenuation, h.r))
+                        break;
+                }
+            }
+        }
+    }
+    long counts[MAT_TYPE_COUNT] = {};
+    for (const shading_hit& h : hits)
+        counts[materials[h.rec.mat_id].type]++;
+    cout << hits.size() << " hits: " << counts[MAT_LAMBERTIAN] << " lambertian, " << counts[MAT_METAL]
+         << " metal, " << counts[MAT_DIELECTRIC] << " dielectric\n";
+
+    // Bucketing is part of the shading stage's cost, so it is timed too.
+    vector<const shading_hit*> buckets[MAT_TYPE_COUNT];
+    auto bucketed = [&]() {
+        for (auto& b : buckets)
+            b.clear();
+        for (const shading_hit& h : hits)
+            buckets[materials[h.rec.mat_id].type].push_back(&h);
+        vec3 sum(0, 0, 0);
+        ray scattered;
+        vec3 attenuation;
+        for (const shading_hit* h : buckets[MAT_LAMBERTIAN])
+            if (lambertian_scatter(materials[h->rec.mat_id], h->r, h->rec, attenuation, scattered))
+                sum += attenuation*scattered.direction();
+        for (const shading_hit* h : buckets[MAT_METAL])
+            if (metal_scatter(materials[h->rec.mat_id], h->r, h->rec, attenuation, scattered))
+                sum += attenuation*scattered.direction();
+        for (const shading_hit* h : buckets[MAT_DIELECTRIC])
+            if (dielectric_scatter(materials[h->rec.mat_id], h->r, h->rec, attenuation, scattered))
+                sum += attenuation*scattered.direction();
+        return sum;
+    };
+
+    double virt = hits_per_sec("virtual:  ", hits.size(), [&]() {
+        vec3 sum(0, 0, 0);
+        ray scattered;
+        vec3 attenuation;
+        for (const shading_hit& h : hits)
+            if (h.mat_ptr->scatter(h.r, h.rec, attenuation, scattered))
+                sum += attenuation*scattered.direction();
+        return sum;
+    });
+    double tagged = hits_per_sec("switch:   ", hits.size(), [&]() {
+        vec3 sum(0, 0, 0);
+        ray scattered;
+        vec3 attenuation;
+        for (const shading_hit& h : hits)
+            if (scatter(materials[h.rec.mat_id], h.r, h.rec, attenuation, scattered))
+                sum += attenuation*scattered.direction();
+        return sum;
+    });
+    double sorted = hits_per_sec("bucketed: ", hits.size(), bucketed);
+    cout << "switch/virtual " << tagged / virt << "x, bucketed/virtual " << sorted / virt << "x\n";
+    cout << "(bucketed draws random numbers in a different order, so its sum differs)\n";
+}
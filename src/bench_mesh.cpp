@@ -0,0 +1,150 @@
+#include <iostream>
+#include <chrono>
+#include <cfloat>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include "random.h"
+#include "triangle_mesh.h"
+using namespace std;
+
+// triangle_mesh on a tessellated sphere of about a million triangles:
+// reading it back from an OBJ file, building its BVH, and tracing rays at
+// it. Then a watertightness check on a small sphere mesh, shooting rays
+// from inside at its vertices and edges, where a closed mesh must always
+// be hit; the watertight kernel is compared with Moller-Trumbore. The OBJ
+// file goes in the directory given as the first argument (default /tmp).
+
+double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool write_obj(const string& path, const vector<vec3>& vertices, const vector<int32_t>& indices) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+    for (const vec3& v : vertices)
+        fprintf(f, "v %.9g %.9g %.9g\n", double(v[0]), double(v[1]), double(v[2]));
+    for (size_t k = 0; k < indices.size(); k += 3)
+        fprintf(f, "f %d %d %d\n", indices[k] + 1, indices[k + 1] + 1, indices[k + 2] + 1);
+    return fclose(f) == 0;
+}
+
+// The textbook test, for comparison: edges from p0, barycentrics by
+// Cramer's rule, each checked against [0, 1] on its own.
+bool hit_moller_trumbore(const ray& r, const vec3& p0, const vec3& p1, const vec3& p2, real tmin, real tmax) {
+    vec3 e1 = p1 - p0, e2 = p2 - p0;
+    vec3 pv = cross(r.direction(), e2);
+    real det = dot(e1, pv);
+    if (det == 0)
+        return false;
+    real inv_det = real(1) / det;
+    vec3 tv = r.origin() - p0;
+    real u = dot(tv, pv) * inv_det;
+    if (u < 0 || u > 1)
+        return false;
+    vec3 qv = cross(tv, e1);
+    real v = dot(r.direction(), qv) * inv_det;
+    if (v < 0 || u + v > 1)
+        return false;
+    real t = dot(e2, qv) * inv_det;
+    return t > tmin && t < tmax;
+}
+
+int main(int argc, char** argv) {
+    string dir = argc > 1 ? argv[1] : "/tmp";
+    string path = dir + "/bench_mesh.obj";
+
+    vector<vec3> vertices;
+    vector<int32_t> indices;
+    sphere_mesh(vec3(0, 0, 0), 1, 1024, 512, vertices, indices);
+    if (!write_obj(path, vertices, indices)) {
+        cerr << "could not write " << path << "\n";
+        return 1;
+    }
+    FILE* f = fopen(path.c_str(), "rb");
+    fseek(f, 0, SEEK_END);
+    double megabytes = ftell(f) / double(1 << 20);
+    fclose(f);
+
+    string error;
+    auto start = chrono::steady_clock::now();
+    if (!read_obj(path, vertices, indices, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    double read_s = seconds_since(start);
+    remove(path.c_str());
+    start = chrono::steady_clock::now();
+    triangle_mesh mesh(move(vertices), move(indices), 0);
+    double build_s = seconds_since(start);
+    cout << mesh.triangle_count() << " triangles, " << mesh.vertices.size() << " vertices, "
+         << mesh.nodes.size() << " nodes\n";
+    cout << "read_obj: " << read_s * 1000 << " ms (" << megabytes / read_s << " MiB/s)\n";
+    cout << "build:    " << build_s * 1000 << " ms\n";
+
+    // Incoherent rays, from a shell around the mesh at points inside it so
+    // all of them hit, then coherent ones through a pinhole on a grid that
+    // covers the mesh, as camera rays would be.
+    seed_random(1);
+    const int nrays = 1 << 20;
+    vector<ray> incoherent(nrays), coherent(nrays);
+    for (ray& r : incoherent) {
+        vec3 from(random_double() - 0.5, random_double() - 0.5, random_double() - 0.5);
+        vec3 to(random_double() - 0.5, random_double() - 0.5, random_double() - 0.5);
+        from = real(3) * unit_vector(from);
+        r = ray(from, to - from);
+    }
+    for (int k = 0; k < nrays; k++) {
+        real x = real(k % 1024) / 512 - 1, y = real(k / 1024) / 512 - 1;
+        coherent[k] = ray(vec3(0, 0, 3), vec3(x, y, -2));
+    }
+    hit_record rec;
+    for (auto batch : { make_pair("incoherent", &incoherent), make_pair("coherent", &coherent) }) {
+        int hits = 0;
+        start = chrono::steady_clock::now();
+        for (const ray& r : *batch.second)
+            hits += mesh.hit(r, 0.001, FLT_MAX, rec);
+        double trace_s = seconds_since(start);
+        cout << "trace " << batch.first << ": " << nrays / trace_s / 1e6 << " Mrays/s, "
+             << hits << " of " << nrays << " hit\n";
+    }
+
+    // Watertightness: from a point inside a small closed mesh, aim at every
+    // vertex and at points along every edge.
+    vector<vec3> small_vertices;
+    vector<int32_t> small_indices;
+    sphere_mesh(vec3(0.3, -0.2, 0.1), 1, 24, 12, small_vertices, small_indices);
+    triangle_mesh small(small_vertices, small_indices, 0);
+    vector<vec3> targets = small.vertices;
+    for (size_t k = 0; k < small.indices.size(); k += 3)
+        for (int e = 0; e < 3; e++) {
+            const vec3& a = small.vertices[small.indices[k + e]];
+            const vec3& b = small.vertices[small.indices[k + (e + 1) % 3]];
+            for (int s = 1; s < 16; s++)
+                targets.push_back(a + (b - a) * (real(s) / 16));
+        }
+    const int origins = 64;
+    long tests = 0, watertight_misses = 0, mt_misses = 0;
+    for (int o = 0; o < origins; o++) {
+        vec3 from = vec3(0.3, -0.2, 0.1)
+                  + real(0.5) * vec3(random_double() - 0.5, random_double() - 0.5, random_double() - 0.5);
+        for (const vec3& to : targets) {
+            ray r(from, to - from);
+            tests++;
+            if (!small.hit(r, 0, FLT_MAX, rec))
+                watertight_misses++;
+            bool hit = false;
+            for (size_t k = 0; !hit && k < small.indices.size(); k += 3)
+                hit = hit_moller_trumbore(r, small.vertices[small.indices[k]], small.vertices[small.indices[k + 1]],
+                                          small.vertices[small.indices[k + 2]], 0, FLT_MAX);
+            if (!hit)
+                mt_misses++;
+        }
+    }
+    cout << "rays at vertices and edges from inside a closed mesh (" << tests << "): "
+         << watertight_misses << " missed with the watertight test, "
+         << mt_misses << " with Moller-Trumbore\n";
+    return watertight_misses == 0 ? 0 : 1;
+}
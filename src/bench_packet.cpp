@@ -0,0 +1,76 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include "camera.h"
+#include "packet.h"
+#include "scenes.h"
+using namespace std;
+
+// Primary-ray throughput of ch5's view of random_scene(), tracing camera
+// rays one at a time through linear_bvh and as packets of 8 and 16 jittered
+// samples per pixel.
+
+const int nx = 400, ny = 200, spp = 16;
+
+vector<ray> make_camera_rays() {
+    camera cam(vec3(-2,2,1), vec3(0,0,-1), vec3(0,1,0), 90, float(nx)/float(ny));
+    vector<ray> rays;
+    rays.reserve(nx*ny*spp);
+    for (int j = 0; j < ny; j++)
+        for (int i = 0; i < nx; i++)
+            for (int s = 0; s < spp; s++)
+                rays.push_back(cam.get_ray(float(i + random_double()) / float(nx),
+                                           float(j + random_double()) / float(ny)));
+    return rays;
+}
+
+double single_rays_per_sec(const linear_bvh& world, const vector<ray>& rays, vector<float>& ts) {
+    auto start = chrono::steady_clock::now();
+    for (size_t n = 0; n < rays.size(); n++) {
+        hit_record rec;
+        ts[n] = world.hit(rays[n], 0.001, MAXFLOAT, rec) ? rec.t : -1;
+    }
+    return rays.size() / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template <int N>
+double packet_rays_per_sec(const linear_bvh& world, const vector<ray>& rays, vector<float>& ts) {
+    auto start = chrono::steady_clock::now();
+    ray_packet<N> p;
+    hit_record recs[N];
+    uint32_t all = N == 32 ? ~0u : (1u << N) - 1;
+    for (size_t n = 0; n + N <= rays.size(); n += N) {
+        for (int k = 0; k < N; k++)
+            p.set(k, rays[n + k]);
+        uint32_t hits = hit_packet(world, p, all, 0.001, MAXFLOAT, recs);
+        for (int k = 0; k < N; k++)
+            ts[n + k] = (hits >> k) & 1 ? recs[k].t : -1;
+    }
+    return rays.size() / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int count_mismatches(const vector<float>& a, const vector<float>& b) {
+    int n = 0;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i] != b[i])
+            n++;
+    return n;
+}
+
+int main() {
+    hitable_list *scene = random_scene();
+    linear_bvh world(scene->list, scene->list_size);
+    vector<ray> rays = make_camera_rays();
+    vector<float> t_single(rays.size()), t8(rays.size()), t16(rays.size());
+
+    double single = single_rays_per_sec(world, rays, t_single);
+    double p8 = packet_rays_per_sec<8>(world, rays, t8);
+    double p16 = packet_rays_per_sec<16>(world, rays, t16);
+
+    cout << "packets off:       " << single << " rays/s\n";
+    cout << "packets of 8:      " << p8 << " rays/s (" << p8 / single << "x)\n";
+    cout << "packets of 16:     " << p16 << " rays/s (" << p16 / single << "x)\n";
+    int bad = count_mismatches(t_single, t8) + count_mismatches(t_single, t16);
+    if (bad)
+        cerr << bad << " rays hit something different in packet mode\n";
+}
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "random.h"
+#include "sphere.h"
+using namespace std;
+
+// Speed and accuracy of the ray/sphere solve in float and double, using
+// sphere_root instantiated on vec3_t<float>, vec3_t<double> and, as the
+// reference, vec3_t<long double>. The sphere is random_scene()'s ground
+// (radius 1000), where float is weakest, and rays come from up to 50 units
+// away. Reported per precision:
+//   - relative error of t against the long double solve of the same
+//     (rounded) inputs
+//   - how often a diffuse bounce leaving the hit point hits the same sphere
+//     again ("acne") with no epsilon, and with the renderer's tmin of 0.001
+//   - solves per second
+// The whole renderer in each precision is ch5 built with and without
+// -DREAL_DOUBLE.
+
+const int n = 1 << 18;
+
+struct sample {
+    double ox, oy, oz, dx, dy, dz;  // primary ray
+    double bx, by, bz;              // random unit vector for the bounce
+};
+
+template <typename T>
+vec3_t<T> vec(double x, double y, double z) { return vec3_t<T>(T(x), T(y), T(z)); }
+
+template <typename T>
+void run(const char* name, const vector<sample>& samples) {
+    typedef vec3_t<T> V;
+    typedef vec3_t<long double> L;
+    V center = vec<T>(0, -1000, 0);
+    T radius = 1000;
+    T inf = numeric_limits<T>::infinity();
+
+    double sum_err = 0, max_err = 0;
+    long hits = 0, acne_zero = 0, acne_eps = 0;
+    for (const sample& s : samples) {
+        ray_t<V> r(vec<T>(s.ox, s.oy, s.oz), vec<T>(s.dx, s.dy, s.dz));
+        T t;
+        if (!sphere_root(center, radius, r, T(0), inf, t))
+            continue;
+        hits++;
+
+        // The reference solves the same T-rounded inputs in long double.
+        ray_t<L> rl(L(r.A[0], r.A[1], r.A[2]), L(r.B[0], r.B[1], r.B[2]));
+        long double tl;
+        if (sphere_root(L(center[0], center[1], center[2]), (long double)radius, rl, 0.0L, 1e30L, tl)) {
+            double err = fabs(double((t - tl) / tl));
+            sum_err += err;
+            max_err = max(max_err, err);
+        }
+
+        V p = r.point_at_parameter(t);
+        V normal = (p - center) / radius;
+        ray_t<V> bounce(p, normal + vec<T>(s.bx, s.by, s.bz));
+        T t2;
+        if (sphere_root(center, radius, bounce, T(0), inf, t2))
+            acne_zero++;
+        if (sphere_root(center, radius, bounce, T(0.001), inf, t2))
+            acne_eps++;
+    }
+
+    // Throughput of the primary solve alone.
+    vector<ray_t<V>> rays;
+    for (const sample& s : samples)
+        rays.push_back(ray_t<V>(vec<T>(s.ox, s.oy, s.oz), vec<T>(s.dx, s.dy, s.dz)));
+    double best = 0;
+    for (int pass = 0; pass < 10; pass++) {
+        auto start = chrono::steady_clock::now();
+        long count = 0;
+        for (const ray_t<V>& r : rays) {
+            T t;
+            count += sphere_root(center, radius, r, T(0.001), inf, t);
+        }
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        best = max(best, rays.size() / secs);
+        if (count < 0)
+            cout << count;
+    }
+
+    cout << name << "t rel. error mean " << sum_err / hits << ", max " << max_err
+         << "; acne " << 100.0 * acne_zero / hits << "% (tmin 0), " << 100.0 * acne_eps / hits
+         << "% (tmin 0.001); " << best / 1e6 << "M solves/s\n";
+}
+
+int main() {
+    vector<sample> samples(n);
+    for (sample& s : samples) {
+        s.ox = 100*random_double() - 50;
+        s.oy = 0.5 + 20*random_double();
+        s.oz = 100*random_double() - 50;
+        // Downward directions, so most rays reach the ground.
+        s.dx = 2*random_double() - 1;
+        s.dy = -random_double();
+        s.dz = 2*random_double() - 1;
+        double bx, by, bz, len;
+        do {
+            bx = 2*random_double() - 1;
+            by = 2*random_double() - 1;
+            bz = 2*random_double() - 1;
+            len = bx*bx + by*by + bz*bz;
+        } while (len >= 1 || len < 1e-6);
+        len = sqrt(len);
+        s.bx = bx / len;
+        s.by = by / len;
+        s.bz = bz / len;
+    }
+    run<float>("float:  ", samples);
+    run<double>("double: ", samples);
+}
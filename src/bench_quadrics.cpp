@@ -0,0 +1,99 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "quadrics.h"
+#include "hitablelist.h"
+#include "bench_rays.h"
+using namespace std;
+
+// Rays/sec of a hitable_list of cylinders, cones and disks (a third each,
+// capped or not at random, pointing any way) against quadric_soa with each
+// batch kernel the CPU supports. Every ray is also checked to give a
+// bit-identical hit_record from both, and every hit to lie on the surface
+// it reports, with a unit normal.
+
+// How far p is from the surface of q, relative to its size.
+double surface_error(const quadric_shape& q, const vec3& p) {
+    vec3 offset = p - q.base;
+    double y = dot(offset, q.axis);
+    double across = (offset - real(y)*q.axis).length();
+    double error = 1e30;
+    if (q.type != QUADRIC_DISK) {
+        double r = q.type == QUADRIC_CONE ? q.radius * (1 - y/q.height) : q.radius;
+        error = fabs(across - r);
+    }
+    if (q.type == QUADRIC_DISK || q.capped)
+        error = min(error, fabs(y) + max(0.0, across - q.radius));
+    if (q.type == QUADRIC_CYLINDER && q.capped)
+        error = min(error, fabs(y - q.height) + max(0.0, across - q.radius));
+    return error / q.radius;
+}
+
+int main() {
+    simd_level best = cpu_simd_level();
+    cout << "shapes  list";
+    for (int level = simd_scalar; level <= best; level++)
+        cout << "  soa-" << simd_level_name(simd_level(level));
+    cout << "   (rays/s)\n";
+
+    vector<ray> rays = make_rays(20000);
+    double worst_surface = 0, worst_normal = 0;
+    for (int n : { 16, 64, 256, 1024, 4096 }) {
+        // Keep the total volume roughly constant so hit rates stay similar.
+        float radius = 0.4f / cbrt(float(n));
+        hitable **list = new hitable*[n];
+        quadric_soa soa;
+        for (int i = 0; i < n; i++) {
+            vec3 base(4*random_double() - 2, 4*random_double() - 2, 4*random_double() - 2);
+            vec3 axis(2*random_double() - 1, 2*random_double() - 1, 2*random_double() - 1);
+            real height = radius * (1 + 2*random_double());
+            bool capped = random_double() < 0.5;
+            if (i % 3 == 0) {
+                cylinder* c = new cylinder(base, axis, radius, height, i, capped);
+                soa.add(c->shape);
+                list[i] = c;
+            } else if (i % 3 == 1) {
+                cone* c = new cone(base, axis, radius, height, i, capped);
+                soa.add(c->shape);
+                list[i] = c;
+            } else {
+                disk* d = new disk(base, axis, radius, i);
+                soa.add(d->shape);
+                list[i] = d;
+            }
+        }
+        hitable_list world(list, n);
+
+        for (const ray& r : rays) {
+            hit_record rec;
+            if (world.hit(r, 0.001, MAXFLOAT, rec)) {
+                const quadric_shape* q = nullptr;
+                hitable* h = list[rec.mat_id];
+                if (cylinder* c = dynamic_cast<cylinder*>(h)) q = &c->shape;
+                if (cone* c = dynamic_cast<cone*>(h)) q = &c->shape;
+                if (disk* d = dynamic_cast<disk*>(h)) q = &d->shape;
+                worst_surface = max(worst_surface, surface_error(*q, rec.p));
+                worst_normal = max(worst_normal, fabs(double(rec.normal.length()) - 1));
+            }
+        }
+
+        cout << n << "  " << rays_per_sec(&world, rays);
+        for (int level = simd_scalar; level <= best; level++) {
+            sphere_soa::kernel = sphere_cull_kernel(simd_level(level));
+            int mismatches = 0;
+            for (const ray& r : rays) {
+                hit_record a, b;
+                bool hit_a = world.hit(r, 0.001, MAXFLOAT, a);
+                bool hit_b = soa.hit(r, 0.001, MAXFLOAT, b);
+                if (hit_a != hit_b || (hit_a && !same_record(a, b)))
+                    mismatches++;
+            }
+            if (mismatches)
+                cerr << simd_level_name(simd_level(level)) << ": " << mismatches << " mismatched hits\n";
+            cout << "  " << rays_per_sec(&soa, rays);
+        }
+        cout << "\n";
+    }
+    cout << "worst hit point distance from its surface " << worst_surface
+         << " radii, worst normal length error " << worst_normal << "\n";
+}
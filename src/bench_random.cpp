@@ -0,0 +1,56 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "random.h"
+using namespace std;
+
+// Compares the old rand() based random_double against the per-thread
+// xoshiro256+ generator, on one thread and on every core at once.
+
+inline double rand_double() {
+    return rand() / (RAND_MAX + 1.0);
+}
+
+template <typename F>
+double ns_per_call(F f, long n, int nthreads) {
+    vector<double> sums(nthreads);
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int t = 0; t < nthreads; t++) {
+        threads.emplace_back([&, t]() {
+            double sum = 0;
+            for (long i = 0; i < n; i++)
+                sum += f();
+            sums[t] = sum;
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    auto end = chrono::steady_clock::now();
+    double sum = 0;
+    for (double s : sums)
+        sum += s;
+    // Print the sum so the loop can't be optimized away.
+    cerr << "  (checksum " << sum << ")\n";
+    return chrono::duration<double, nano>(end - start).count() / n;
+}
+
+int main(int argc, char** argv) {
+    long n = argc > 1 ? atol(argv[1]) : 20000000;
+    int ncores = thread::hardware_concurrency();
+    if (ncores <= 0)
+        ncores = 1;
+
+    vector<int> thread_counts = { 1 };
+    if (ncores > 1)
+        thread_counts.push_back(ncores);
+
+    for (int nthreads : thread_counts) {
+        double old_ns = ns_per_call(rand_double, n, nthreads);
+        double new_ns = ns_per_call(random_double, n, nthreads);
+        cout << nthreads << " thread(s): rand() " << old_ns << " ns/call, xoshiro256+ "
+             << new_ns << " ns/call, speedup " << old_ns / new_ns << "x\n";
+    }
+}
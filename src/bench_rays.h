@@ -0,0 +1,53 @@
+#ifndef BENCH_RAYSH
+#define BENCH_RAYSH
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "hitable.h"
+#include "random.h"
+
+// Helpers shared by the benches that race a batched hitable against a
+// hitable_list of the same shapes.
+
+// n rays from random points in [-2, 2]^3 in random directions.
+inline std::vector<ray> make_rays(int n) {
+    std::vector<ray> rays(n);
+    for (int i = 0; i < n; i++) {
+        vec3 origin(4*random_double() - 2, 4*random_double() - 2, 4*random_double() - 2);
+        vec3 dir(2*random_double() - 1, 2*random_double() - 1, 2*random_double() - 1);
+        rays[i] = ray(origin, dir);
+    }
+    return rays;
+}
+
+inline double rays_per_sec(const hitable *world, const std::vector<ray>& rays, double min_seconds = 0.3) {
+    long traced = 0;
+    double elapsed = 0;
+    int hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    do {
+        for (const ray& r : rays) {
+            hit_record rec;
+            if (world->hit(r, 0.001, MAXFLOAT, rec))
+                hits++;
+        }
+        traced += rays.size();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < min_seconds);
+    if (hits < 0)
+        std::cout << hits;
+    return traced / elapsed;
+}
+
+// Bit for bit, so -0 and 0 differ.
+inline bool same_record(const hit_record& a, const hit_record& b) {
+    return memcmp(&a.t, &b.t, sizeof(real)) == 0
+        && memcmp(a.p.e, b.p.e, 3*sizeof(real)) == 0
+        && memcmp(a.normal.e, b.normal.e, 3*sizeof(real)) == 0
+        && a.mat_id == b.mat_id;
+}
+
+#endif
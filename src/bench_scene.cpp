@@ -0,0 +1,139 @@
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <unistd.h>
+#include <vector>
+#include "linear_bvh.h"
+#include "scenes.h"
+using namespace std;
+
+// Building random_scene() at about a million spheres with every object
+// new'd on its own, as it used to be, against the arena-backed scene:
+// allocation count, build time, resident memory, and how fast the spheres
+// can then be walked (a pass over every bounding box, and rays through a
+// linear_bvh over each).
+
+static long allocations = 0;
+
+void* operator new(size_t n) {
+    allocations++;
+    if (void* p = malloc(n))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+long resident_kib() {
+    long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        fclose(f);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Materials of the heap built scene, each new'd on its own like the
+// spheres. Spheres refer to them by index.
+vector<material*> heap_materials;
+
+int heap_material(material* m) {
+    heap_materials.push_back(m);
+    return int(heap_materials.size()) - 1;
+}
+
+// The old random_scene(), one heap allocation per sphere and material.
+hitable_list* heap_random_scene(int extent) {
+    int n = 4*extent*extent + 4;
+    heap_materials.reserve(n);
+    hitable** list = new hitable*[n];
+    list[0] = new sphere(vec3(0,-1000,0), 1000, heap_material(new lambertian(vec3(0.5, 0.5, 0.5))));
+    int i = 1;
+    for (int a = -extent; a < extent; a++) {
+        for (int b = -extent; b < extent; b++) {
+            float choose_mat = random_double();
+            vec3 center(a+0.9*random_double(), 0.2, b+0.9*random_double());
+            if ((center-vec3(4,0.2,0)).length() > 0.9) {
+                if (choose_mat < 0.8)
+                    list[i++] = new sphere(center, 0.2, heap_material(new lambertian(vec3(random_double()*random_double(), random_double()*random_double(), random_double()*random_double()))));
+                else if (choose_mat < 0.95)
+                    list[i++] = new sphere(center, 0.2, heap_material(new metal(vec3(0.5*(1 + random_double()), 0.5*(1 + random_double()), 0.5*(1 + random_double())))));
+                else
+                    list[i++] = new sphere(center, 0.2, heap_material(new dielectric(1.5)));
+            }
+        }
+    }
+    list[i++] = new sphere(vec3(0, 1, 0), 1.0, heap_material(new dielectric(1.5)));
+    list[i++] = new sphere(vec3(-4, 1, 0), 1.0, heap_material(new lambertian(vec3(0.4, 0.2, 0.1))));
+    list[i++] = new sphere(vec3(4, 1, 0), 1.0, heap_material(new metal(vec3(0.7, 0.6, 0.5))));
+    return new hitable_list(list, i);
+}
+
+// Best of a few passes over every primitive's bounding box, in list order.
+double boxes_per_sec(const hitable_list* world, float& checksum) {
+    double best = 0;
+    for (int pass = 0; pass < 5; pass++) {
+        auto start = chrono::steady_clock::now();
+        aabb box;
+        for (int i = 0; i < world->list_size; i++)
+            box = aabb(box, world->list[i]->bounding_box());
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        checksum = box.x.max;
+        best = max(best, world->list_size / secs);
+    }
+    return best;
+}
+
+double rays_per_sec(const linear_bvh& world, const vector<ray>& rays, int& hits) {
+    auto start = chrono::steady_clock::now();
+    hits = 0;
+    for (const ray& r : rays) {
+        hit_record rec;
+        if (world.hit(r, 0.001, MAXFLOAT, rec))
+            hits++;
+    }
+    return rays.size() / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+template <typename Build>
+void measure(const char* name, int extent, const vector<ray>& rays, Build build) {
+    seed_random(1);
+    long rss = resident_kib();
+    long allocs = allocations;
+    auto start = chrono::steady_clock::now();
+    hitable_list* world = build(extent);
+    double build_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    allocs = allocations - allocs;
+    rss = resident_kib() - rss;
+
+    float checksum;
+    double boxes = boxes_per_sec(world, checksum);
+    linear_bvh bvh(world->list, world->list_size);
+    int hits;
+    double rate = rays_per_sec(bvh, rays, hits);
+
+    cout << name << world->list_size << " spheres, " << allocs << " allocations, "
+         << build_ms << " ms, " << rss / 1024 << " MiB resident, "
+         << boxes / 1e6 << "M boxes/s, " << rate << " rays/s (" << hits << " hits)\n";
+}
+
+int main() {
+    const int extent = 500;
+    vector<ray> rays(200000);
+    seed_random(2);
+    for (ray& r : rays) {
+        vec3 origin((2*random_double() - 1)*extent, 0.5 + 2*random_double(), (2*random_double() - 1)*extent);
+        vec3 dir(2*random_double() - 1, -random_double(), 2*random_double() - 1);
+        r = ray(origin, dir);
+    }
+
+    // The arena scene goes first so the heap version's leftovers don't count
+    // against it.
+    measure("arena: ", extent, rays, [](int e) -> hitable_list* { return random_scene(e); });
+    measure("heap:  ", extent, rays, [](int e) { return heap_random_scene(e); });
+}
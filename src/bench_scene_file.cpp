@@ -0,0 +1,91 @@
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include "linear_bvh.h"
+#include "scene_file.h"
+#include "scenes.h"
+using namespace std;
+
+// Loading random_scene() at about a million spheres from each scene file
+// form: parsing the text into records, mapping the binary file, and from
+// either, building the renderable scene. The files go in the directory
+// given as the first argument (default /tmp).
+
+double ms_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+long file_size(const string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return -1;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fclose(f);
+    return n;
+}
+
+int main(int argc, char** argv) {
+    string dir = argc > 1 ? argv[1] : "/tmp";
+    string text_path = dir + "/bench_scene_file.scene";
+    string binary_path = dir + "/bench_scene_file.rtsb";
+
+    scene_description desc;
+    scene* original = random_scene(500);
+    describe_scene(*original, desc);
+    if (!write_scene_text(text_path, desc.view()) || !write_scene_binary(binary_path, desc.view())) {
+        cerr << "could not write the scene files in " << dir << "\n";
+        return 1;
+    }
+    cout << desc.spheres.size() << " spheres, " << desc.materials.size() << " materials; text "
+         << file_size(text_path) / (1 << 20) << " MiB, binary " << file_size(binary_path) / (1 << 20) << " MiB\n";
+
+    string error;
+    auto start = chrono::steady_clock::now();
+    scene_description text;
+    if (!read_scene_text(text_path, text, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    double parse_ms = ms_since(start);
+    scene* from_text = make_scene(text.view(), error);
+    double text_ms = ms_since(start);
+
+    start = chrono::steady_clock::now();
+    mapped_scene_file mapped;
+    if (!mapped.open(binary_path, error)) {
+        cerr << error << "\n";
+        return 1;
+    }
+    double map_ms = ms_since(start);
+    scene* from_binary = make_scene(mapped.view(), error);
+    double binary_ms = ms_since(start);
+
+    cout << "text:   parse " << parse_ms << " ms, total " << text_ms << " ms\n";
+    cout << "binary: map and check " << map_ms << " ms, total " << binary_ms << " ms\n";
+
+    // Both must give back exactly the scene that was written.
+    bool same = from_text->list_size == original->list_size && from_binary->list_size == original->list_size;
+    for (int k = 0; same && k < original->list_size; k++) {
+        const sphere* a = static_cast<const sphere*>(original->list[k]);
+        const sphere* b = static_cast<const sphere*>(from_text->list[k]);
+        const sphere* c = static_cast<const sphere*>(from_binary->list[k]);
+        for (int i = 0; i < 3; i++)
+            same = same && a->center[i] == b->center[i] && a->center[i] == c->center[i];
+        same = same && a->radius == b->radius && a->radius == c->radius;
+        // Table order may differ, so materials are compared by value.
+        const material* ma = &original->materials[a->mat_id];
+        for (const material* m : { &from_text->materials[b->mat_id], &from_binary->materials[c->mat_id] })
+            same = same && m->type == ma->type && m->ref_idx == ma->ref_idx
+                        && m->albedo[0] == ma->albedo[0] && m->albedo[1] == ma->albedo[1] && m->albedo[2] == ma->albedo[2];
+    }
+    cout << (same ? "round trip exact\n" : "round trip MISMATCH\n");
+
+    start = chrono::steady_clock::now();
+    linear_bvh bvh(from_binary->list, from_binary->list_size);
+    cout << "(linear_bvh over the loaded scene: " << ms_since(start) << " ms)\n";
+    remove(text_path.c_str());
+    remove(binary_path.c_str());
+    return same ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+#include "sdf.h"
+#include "random.h"
+using namespace std;
+
+// Rays/sec and field evaluations per ray sphere-tracing a lumpy field: 64
+// displaced spheres smooth-joined in a balanced tree, around a box with a
+// torus cut out of it. Plain sphere tracing, over-relaxed tracing, and
+// over-relaxed tracing with a distance grid cache, each checked against
+// plain tracing for which rays hit and where. A ray passing within the hit
+// tolerance of a surface stops there under one and may step past it under
+// another, so a few hits can land on different surfaces.
+//
+// Then rays from inside, as refraction casts, for the field and for a lone
+// sphere, whose far side lies right at the end of its bounding sphere where
+// relaxed steps overshoot. Nearly all of them should find the way out
+// under every variant.
+
+vector<ray> make_rays(int n) {
+    vector<ray> rays(n);
+    for (int i = 0; i < n; i++) {
+        vec3 origin(12*random_double() - 6, 12*random_double() - 6, 12*random_double() - 6);
+        vec3 target(4*random_double() - 2, 4*random_double() - 2, 4*random_double() - 2);
+        rays[i] = ray(origin, target - origin);
+    }
+    return rays;
+}
+
+// n rays in random directions from random points well inside shape root.
+vector<ray> make_inside_rays(const sdf_tree& tree, int root, int n) {
+    vector<ray> rays(n);
+    for (int i = 0; i < n; i++) {
+        vec3 origin;
+        do {
+            origin = vec3(4*random_double() - 2, 4*random_double() - 2, 4*random_double() - 2);
+        } while (tree.distance(root, origin) > -0.05);
+        vec3 dir(2*random_double() - 1, 2*random_double() - 1, 2*random_double() - 1);
+        rays[i] = ray(origin, dir);
+    }
+    return rays;
+}
+
+// Joins nodes[lo, hi) pairwise so that each union's children are near
+// each other and their spheres stay tight.
+int join_all(sdf_tree& tree, const vector<int>& nodes, int lo, int hi) {
+    if (hi - lo == 1)
+        return nodes[lo];
+    int mid = (lo + hi) / 2;
+    return tree.smooth_join(join_all(tree, nodes, lo, mid), join_all(tree, nodes, mid, hi), 0.2);
+}
+
+int main() {
+    sdf_tree tree;
+    vector<int> blobs;
+    for (int x = 0; x < 4; x++)
+        for (int y = 0; y < 4; y++)
+            for (int z = 0; z < 4; z++) {
+                vec3 center(x - 1.5 + 0.3*random_double(), y - 1.5 + 0.3*random_double(), z - 1.5 + 0.3*random_double());
+                blobs.push_back(tree.displace(tree.sphere(center, 0.25 + 0.1*random_double()), 0.04, 6));
+            }
+    int shell = tree.subtract(tree.box(vec3(0, 0, 0), vec3(0.6, 0.6, 0.6)), tree.torus(vec3(0, 0, 0), 0.6, 0.2));
+    blobs.push_back(shell);
+    int root = join_all(tree, blobs, 0, int(blobs.size()));
+
+    auto start = chrono::steady_clock::now();
+    sdf_grid cache(tree, root);
+    double build = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("grid cache: %.3f s to build, %.2f MiB\n", build, cache.memory() / 1048576.0);
+
+    vector<ray> rays = make_rays(20000);
+    struct variant { const char* name; real relaxation; const sdf_grid* cache; };
+    variant variants[] = { { "plain", 1, nullptr }, { "over-relaxed", 1.25, nullptr }, { "relaxed+grid", 1.25, &cache } };
+
+    vector<char> hits[3];
+    vector<real> ts[3];
+    for (int v = 0; v < 3; v++) {
+        sdf_object shape(&tree, root, 0, variants[v].cache);
+        shape.relaxation = variants[v].relaxation;
+        hits[v].resize(rays.size());
+        ts[v].resize(rays.size());
+        long steps = 0;
+        for (size_t k = 0; k < rays.size(); k++) {
+            real t;
+            int n;
+            hits[v][k] = shape.trace(rays[k], 0.001, FLT_MAX, t, n);
+            ts[v][k] = t;
+            steps += n;
+        }
+
+        long traced = 0, sink = 0;
+        double elapsed = 0;
+        start = chrono::steady_clock::now();
+        do {
+            for (const ray& r : rays) {
+                hit_record rec;
+                sink += shape.hit(r, 0.001, FLT_MAX, rec);
+            }
+            traced += rays.size();
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < 0.5);
+        if (sink < 0)
+            cout << sink;
+
+        int disagree = 0;
+        double worst = 0;
+        for (size_t k = 0; k < rays.size(); k++) {
+            disagree += hits[v][k] != hits[0][k];
+            if (hits[v][k] && hits[0][k])
+                worst = max(worst, double(fabs(ts[v][k] - ts[0][k]) * rays[k].direction().length()));
+        }
+        printf("%-13s %6.3f Mrays/s, %6.1f steps/ray, %d of %zu rays disagree with plain, worst distance apart %.2g\n",
+               variants[v].name, traced / elapsed / 1e6, double(steps) / rays.size(), disagree, rays.size(), worst);
+    }
+
+    int ball = tree.sphere(vec3(0, 0, 0), 1);
+    struct target { const char* name; int root; };
+    for (target shape_target : { target{ "field", root }, target{ "sphere", ball } }) {
+        vector<ray> inside = make_inside_rays(tree, shape_target.root, 5000);
+        vector<char> plain_hits;
+        for (int v = 0; v < 3; v++) {
+            // The grid caches the field only.
+            sdf_object shape(&tree, shape_target.root, 0, shape_target.root == root ? variants[v].cache : nullptr);
+            shape.relaxation = variants[v].relaxation;
+            int hit = 0, disagree = 0;
+            for (size_t k = 0; k < inside.size(); k++) {
+                real t;
+                int n;
+                bool h = shape.trace(inside[k], 0.001, FLT_MAX, t, n);
+                if (v == 0)
+                    plain_hits.push_back(h);
+                hit += h;
+                disagree += h != plain_hits[k];
+            }
+            printf("%-13s from inside the %-6s %4d of %zu rays hit, %d disagree with plain\n", variants[v].name,
+                   shape_target.name, hit, inside.size(), disagree);
+        }
+    }
+}
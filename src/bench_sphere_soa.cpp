@@ -0,0 +1,53 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "sphere_soa.h"
+#include "hitablelist.h"
+#include "bench_rays.h"
+using namespace std;
+
+// Rays/sec of a hitable_list of spheres against sphere_soa with each batch
+// kernel the CPU supports. Every ray is also checked to give a bit-identical
+// hit_record from both, which is the contract sphere_soa promises.
+
+int main() {
+    simd_level best = cpu_simd_level();
+    cout << "spheres  list";
+    for (int level = simd_scalar; level <= best; level++)
+        cout << "  soa-" << simd_level_name(simd_level(level));
+    cout << "   (rays/s)\n";
+
+    vector<ray> rays = make_rays(20000);
+    auto coord = []() { return floor(4*random_double() * (1 << 20)) / (1 << 20) - 2; };
+    for (int n : { 16, 64, 256, 1024, 4096 }) {
+        // Keep the total volume roughly constant so hit rates stay similar.
+        float radius = 0.5f / cbrt(float(n));
+        hitable **list = new hitable*[n];
+        sphere_soa soa;
+        for (int i = 0; i < n; i++) {
+            // sphere_soa stores centres as floats. Multiples of 2^-20 are
+            // exact as floats, so a double build compares like for like.
+            vec3 center(coord(), coord(), coord());
+            list[i] = new sphere(center, radius, i);
+            soa.add(center, radius, i);
+        }
+        hitable_list world(list, n);
+
+        cout << n << "  " << rays_per_sec(&world, rays);
+        for (int level = simd_scalar; level <= best; level++) {
+            sphere_soa::kernel = sphere_cull_kernel(simd_level(level));
+            int mismatches = 0;
+            for (const ray& r : rays) {
+                hit_record a, b;
+                bool hit_a = world.hit(r, 0.001, MAXFLOAT, a);
+                bool hit_b = soa.hit(r, 0.001, MAXFLOAT, b);
+                if (hit_a != hit_b || (hit_a && !same_record(a, b)))
+                    mismatches++;
+            }
+            if (mismatches)
+                cerr << simd_level_name(simd_level(level)) << ": " << mismatches << " mismatched hits\n";
+            cout << "  " << rays_per_sec(&soa, rays);
+        }
+        cout << "\n";
+    }
+}
@@ -0,0 +1,374 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "hitablelist.h"
+#include "integrator.h"
+#include "linear_bvh.h"
+#include "materials.h"
+#include "path_stats.h"
+#include "perlin.h"
+#include "scenes.h"
+#include "sphere.h"
+#include "tile_renderer.h"
+using namespace std;
+
+// The hot kernels one at a time, plus a whole ch5 frame, with one JSON
+// object per line on stdout so runs can be saved and compared:
+//     ./bench_suite > before.json
+//     ... change something, rebuild ...
+//     ./bench_suite -baseline before.json
+// With -baseline every result is also compared against the saved run on
+// stderr, and the exit status is 1 if anything got slower by more than
+// -tolerance percent (default 10). -filter runs only the benchmarks whose
+// name contains the given string.
+//
+// Each kernel runs over a fixed batch of inputs, repeated until -min-time
+// seconds (default 0.25) have passed, and the fastest batch is reported.
+// ns_per_op is what the comparison uses; rays_per_sec and samples_per_sec
+// are added where an op is a ray or a sample.
+
+struct options {
+    string filter;
+    double min_time = 0.25;
+    string baseline;
+    double tolerance = 10;
+    int nthreads = 0;
+    int spp = 8;
+};
+
+options opts;
+map<string, double> baseline_ns;
+int regressions = 0;
+
+// Reads "name" and "ns_per_op" back out of a previous run's output. Only
+// this program's own lines need to parse, so there is no general JSON here.
+bool load_baseline(const string& path) {
+    ifstream in(path);
+    if (!in)
+        return false;
+    string line;
+    while (getline(in, line)) {
+        size_t name = line.find("\"name\":\"");
+        size_t ns = line.find("\"ns_per_op\":");
+        if (name == string::npos || ns == string::npos)
+            continue;
+        name += strlen("\"name\":\"");
+        size_t end = line.find('"', name);
+        if (end == string::npos)
+            continue;
+        baseline_ns[line.substr(name, end - name)] = atof(line.c_str() + ns + strlen("\"ns_per_op\":"));
+    }
+    return true;
+}
+
+bool selected(const string& name) {
+    return opts.filter.empty() || name.find(opts.filter) != string::npos;
+}
+
+// Prints one result line. fields holds any extra ",\"key\":value" pairs.
+void report(const string& name, double ns_per_op, long ops, const string& fields = "") {
+    cout << "{\"name\":\"" << name << "\",\"ns_per_op\":" << ns_per_op
+         << ",\"ops_per_sec\":" << 1e9 / ns_per_op << ",\"ops\":" << ops << fields << "}" << endl;
+
+    auto base = baseline_ns.find(name);
+    if (base == baseline_ns.end())
+        return;
+    double change = 100 * (ns_per_op - base->second) / base->second;
+    bool slower = change > opts.tolerance;
+    regressions += slower;
+    cerr << name << ": " << base->second << " -> " << ns_per_op << " ns/op ("
+         << (change >= 0 ? "+" : "") << change << "%)" << (slower ? "  REGRESSION" : "") << "\n";
+}
+
+string field(const char* key, double value) {
+    ostringstream s;
+    s << ",\"" << key << "\":" << value;
+    return s.str();
+}
+
+// The kernel runs a batch of n ops and returns something derived from the
+// results, which is kept so the work can't be optimized away.
+double sink = 0;
+
+template <typename Batch>
+double best_ns_per_op(long n, Batch batch) {
+    double best = 1e300, elapsed = 0;
+    auto start = chrono::steady_clock::now();
+    do {
+        auto batch_start = chrono::steady_clock::now();
+        sink += batch();
+        auto now = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double, nano>(now - batch_start).count() / n);
+        elapsed = chrono::duration<double>(now - start).count();
+    } while (elapsed < opts.min_time);
+    return best;
+}
+
+template <typename Batch>
+void run(const string& name, long n, Batch batch, const char* per_sec = nullptr) {
+    if (!selected(name))
+        return;
+    double ns = best_ns_per_op(n, batch);
+    report(name, ns, n, per_sec ? field(per_sec, 1e9 / ns) : "");
+}
+
+vec3 random_vec3(double lo, double hi) {
+    return vec3(lo + (hi - lo)*random_double(), lo + (hi - lo)*random_double(), lo + (hi - lo)*random_double());
+}
+
+const int batch = 1 << 12;
+
+void bench_sphere() {
+    // Rays from the surrounding box aimed at points inside the unit sphere
+    // always hit; aimed a little past its silhouette they always miss,
+    // after computing the discriminant.
+    sphere s(vec3(0, 0, 0), 1, 0);
+    vector<ray> hits(batch), misses(batch);
+    for (int k = 0; k < batch; k++) {
+        vec3 origin = unit_vector(random_vec3(-1, 1)) * 5;
+        hits[k] = ray(origin, random_vec3(-0.5, 0.5) - origin);
+        vec3 aside = unit_vector(cross(origin, random_vec3(-1, 1)));
+        misses[k] = ray(origin, aside * 1.5 - origin);
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        const vector<ray>& rays = pass == 0 ? hits : misses;
+        run(pass == 0 ? "sphere_hit/hit" : "sphere_hit/miss", batch, [&]() {
+            double sum = 0;
+            hit_record rec;
+            for (const ray& r : rays)
+                if (s.hit(r, 0.001, MAXFLOAT, rec))
+                    sum += rec.t;
+            return sum;
+        }, "rays_per_sec");
+    }
+}
+
+void bench_list() {
+    // Spheres of radius 0.2 scattered through a box of side 10, so a ray
+    // typically hits a few of the larger lists and none of the smaller.
+    for (int n : { 1, 4, 16, 64, 256, 1024 }) {
+        vector<sphere> spheres;
+        for (int k = 0; k < n; k++)
+            spheres.push_back(sphere(random_vec3(-5, 5), 0.2, 0));
+        vector<hitable*> list;
+        for (sphere& s : spheres)
+            list.push_back(&s);
+        hitable_list world(list.data(), n);
+        vector<ray> rays(batch);
+        for (ray& r : rays)
+            r = ray(random_vec3(-5, 5), random_vec3(-1, 1));
+        string name = "hitable_list_hit/" + to_string(n);
+        if (!selected(name))
+            continue;
+        double ns = best_ns_per_op(batch, [&]() {
+            double sum = 0;
+            hit_record rec;
+            for (const ray& r : rays)
+                if (world.hit(r, 0.001, MAXFLOAT, rec))
+                    sum += rec.t;
+            return sum;
+        });
+        report(name, ns, batch, field("objects", n) + field("rays_per_sec", 1e9 / ns));
+    }
+}
+
+void bench_scatter() {
+    // Hit records from rays striking a unit sphere, from outside and (for
+    // the dielectric) a share from inside.
+    sphere s(vec3(0, 0, 0), 1, 0);
+    vector<ray> rays;
+    vector<hit_record> recs;
+    while (int(recs.size()) < batch) {
+        vec3 origin = random_double() < 0.25 ? random_vec3(-0.5, 0.5) : unit_vector(random_vec3(-1, 1)) * 5;
+        ray r(origin, random_vec3(-0.5, 0.5) - origin);
+        hit_record rec;
+        if (s.hit(r, 0.001, MAXFLOAT, rec)) {
+            rays.push_back(r);
+            recs.push_back(rec);
+        }
+    }
+    material_table materials;
+    materials.add(lambertian(vec3(0.5, 0.5, 0.5)));
+    materials.add(metal(vec3(0.7, 0.6, 0.5)));
+    materials.add(dielectric(1.5));
+    const char* names[] = { "scatter/lambertian", "scatter/metal", "scatter/dielectric" };
+    for (int id = 0; id < materials.size(); id++) {
+        const material& m = materials[id];
+        run(names[id], batch, [&]() {
+            double sum = 0;
+            vec3 attenuation;
+            ray scattered;
+            for (int k = 0; k < batch; k++)
+                if (scatter(m, rays[k], recs[k], attenuation, scattered))
+                    sum += scattered.direction().x();
+            return sum;
+        });
+    }
+}
+
+void bench_sampling(const camera& cam) {
+    run("random_double", batch, []() {
+        double sum = 0;
+        for (int k = 0; k < batch; k++)
+            sum += random_double();
+        return sum;
+    });
+    run("random_in_unit_sphere", batch, []() {
+        double sum = 0;
+        for (int k = 0; k < batch; k++)
+            sum += random_in_unit_sphere().x();
+        return sum;
+    });
+
+    perlin noise;
+    vector<vec3> points(batch);
+    for (vec3& p : points)
+        p = random_vec3(-64, 64);
+    run("perlin_noise", batch, [&]() {
+        double sum = 0;
+        for (const vec3& p : points)
+            sum += noise.noise(p);
+        return sum;
+    });
+
+    // The same points 8 at a time, as separate coordinate arrays.
+    vector<float> xs(batch), ys(batch), zs(batch), values(batch);
+    for (int k = 0; k < batch; k++) {
+        xs[k] = points[k].x();
+        ys[k] = points[k].y();
+        zs[k] = points[k].z();
+    }
+    run("perlin_noise8", batch, [&]() {
+        for (int k = 0; k < batch; k += 8)
+            noise.noise8(&xs[k], &ys[k], &zs[k], &values[k]);
+        return double(values[0]);
+    });
+    run("perlin_fbm", batch / 8, [&]() {
+        double sum = 0;
+        for (int k = 0; k < batch; k += 8)
+            sum += noise.fbm(points[k]);
+        return sum;
+    });
+    run("perlin_fbm8", batch, [&]() {
+        for (int k = 0; k < batch; k += 8)
+            noise.fbm8(&xs[k], &ys[k], &zs[k], &values[k]);
+        return double(values[0]);
+    });
+
+    vector<float> us(batch), vs(batch);
+    for (int k = 0; k < batch; k++) {
+        us[k] = random_double();
+        vs[k] = random_double();
+    }
+    run("camera_get_ray", batch, [&]() {
+        double sum = 0;
+        for (int k = 0; k < batch; k++)
+            sum += cam.get_ray(us[k], vs[k]).direction().x();
+        return sum;
+    }, "rays_per_sec");
+}
+
+// ch5's default render, at a lower sample count (-spp). Rays counts every
+// ray cast, camera and scattered, from the path stats: each path casts one
+// more ray than it has bounces. The renderer's workers flush their counts
+// at the end of each render, so the totals taken around it are complete
+// whatever the thread count. Every render is the same, with seed 1, so the
+// last one's count goes with the best time.
+void bench_render(const camera& cam, int nx, int ny) {
+    const string name = "render/ch5";
+    if (!selected(name))
+        return;
+    seed_random(1);
+    scene* objects = random_scene();
+    linear_bvh world(objects->list, objects->list_size);
+    const material_table& materials = objects->materials;
+    tile_renderer renderer(nx, ny, 16, opts.nthreads);
+    vector<vec3> framebuffer;
+    int ns = opts.spp;
+
+    double best = 1e300, elapsed = 0;
+    long rays = 0;
+    do {
+        path_stats before = collect_path_stats();
+        auto start = chrono::steady_clock::now();
+        renderer.render([&](int i, int j) {
+            vec3 col(0, 0, 0);
+            for (int s = 0; s < ns; s++) {
+                float u = float(i + random_double()) / float(nx);
+                float v = float(j + random_double()) / float(ny);
+                col += color(cam.get_ray(u, v), &world, materials);
+            }
+            return col / float(ns);
+        }, framebuffer, 1);
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        path_stats after = collect_path_stats();
+        rays = (after.paths() + after.bounces()) - (before.paths() + before.bounces());
+        if (after.paths() - before.paths() != long(nx)*ny*ns)
+            cerr << name << ": path stats missed some samples\n";
+        best = min(best, secs);
+        elapsed += secs;
+        sink += framebuffer[nx*ny/2].x();
+    } while (elapsed < opts.min_time);
+
+    long samples = long(nx)*ny*ns;
+    report(name, 1e9 * best / samples, samples,
+           field("samples_per_sec", samples / best) + field("rays_per_sec", rays / best)
+           + field("seconds", best) + field("threads", renderer.nthreads));
+}
+
+int main(int argc, char** argv) {
+    for (int a = 1; a < argc; a++) {
+        string arg = argv[a];
+        if (arg == "-filter" && a+1 < argc)
+            opts.filter = argv[++a];
+        else if (arg == "-min-time" && a+1 < argc)
+            opts.min_time = atof(argv[++a]);
+        else if (arg == "-baseline" && a+1 < argc)
+            opts.baseline = argv[++a];
+        else if (arg == "-tolerance" && a+1 < argc)
+            opts.tolerance = atof(argv[++a]);
+        else if (arg == "-t" && a+1 < argc)
+            opts.nthreads = atoi(argv[++a]);
+        else if (arg == "-spp" && a+1 < argc)
+            opts.spp = max(1, atoi(argv[++a]));
+        else {
+            cerr << "usage: " << argv[0] << " [-filter name] [-min-time seconds] [-t threads] [-spp samples]\n"
+                 << "       [-baseline previous.json [-tolerance percent]]\n";
+            return 1;
+        }
+    }
+    if (!opts.baseline.empty() && !load_baseline(opts.baseline)) {
+        cerr << "could not read " << opts.baseline << "\n";
+        return 1;
+    }
+
+    // The build settings that change what the numbers mean.
+    cout << "{\"name\":\"build\",\"real\":\"" << (sizeof(real) == 8 ? "double" : "float")
+#if defined(VEC3_SIMD) && defined(__SSE2__) && !defined(REAL_DOUBLE)
+         << "\",\"vec3\":\"sse"
+#else
+         << "\",\"vec3\":\"scalar"
+#endif
+         << "\",\"compiler\":\"" << __VERSION__ << "\"}" << endl;
+
+    const int nx = 400, ny = 200;
+    camera cam(vec3(-2,2,1), vec3(0,0,-1), vec3(0,1,0), 90, float(nx)/float(ny));
+    seed_random(1);
+    bench_sphere();
+    bench_list();
+    bench_scatter();
+    bench_sampling(cam);
+    bench_render(cam, nx, ny);
+
+    cerr << "(checksum " << sink << ")\n";
+    if (regressions)
+        cerr << regressions << " benchmark(s) slower than the baseline by more than " << opts.tolerance << "%\n";
+    return regressions ? 1 : 0;
+}
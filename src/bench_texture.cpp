@@ -0,0 +1,149 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "texture_cache.h"
+#include "random.h"
+using namespace std;
+
+// Lookups/sec and miss rate of a 4096x4096 image texture (85 MiB of tiles
+// with its mip levels) at tile budgets from a twentieth of that to all of
+// it, with memory actually resident alongside. Two access patterns:
+//
+//   coherent  a 2048x2048 image of the whole texture drawn in 16x16 pixel
+//             blocks, as the tile renderer does, with the footprint of a
+//             pixel, so lookups read level 1
+//   random    uniform (u, v) with no footprint, so every lookup reads a
+//             random spot of the full-resolution level
+//
+// Coherent lookups keep hitting whatever the budget; random ones miss in
+// proportion to how much of the level doesn't fit. Last, coherent lookups
+// from 1 up to one thread per core at once, with the blocks dealt out
+// among them, to show how lookups scale as the shards spread the locking.
+
+const int side = 4096, screen = 2048, block = 16;
+
+// Resident memory of this process, from /proc.
+double resident_mib() {
+    long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        fclose(f);
+    }
+    return resident * double(sysconf(_SC_PAGESIZE)) / 1048576;
+}
+
+// Looks up every pixel of every nth block of the screen, starting at
+// block first, and returns the number of lookups.
+long coherent(texture_cache& cache, int first, int nth, vec3& sink) {
+    const int per_row = screen / block;
+    real footprint = real(1) / screen;
+    long count = 0;
+    for (int b = first; b < per_row * per_row; b += nth) {
+        int bx = b % per_row * block, by = b / per_row * block;
+        for (int y = by; y < by + block; y++)
+            for (int x = bx; x < bx + block; x++)
+                sink += cache.sample(0, (x + real(0.5)) / screen, (y + real(0.5)) / screen, footprint);
+        count += block * block;
+    }
+    return count;
+}
+
+void run_threads(texture_cache& cache, int nthreads) {
+    cache.reset_stats();
+    atomic<long> count(0);
+    auto start = chrono::steady_clock::now();
+    auto elapsed = [&] { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+    vector<thread> threads;
+    for (int id = 0; id < nthreads; id++) {
+        threads.emplace_back([&, id] {
+            vec3 sink(0, 0, 0);
+            long n = 0;
+            do {
+                n += coherent(cache, id, nthreads, sink);
+            } while (elapsed() < 0.5);
+            count += n;
+            if (sink[0] < 0)
+                cout << sink;
+        });
+    }
+    for (thread& t : threads)
+        t.join();
+    double seconds = elapsed();
+    texture_cache::counters c = cache.stats();
+    printf("  %3d threads %7.2f Mlookups/s, %6.2f%% of tile reads missed\n", nthreads, count / seconds / 1e6,
+           100.0 * c.misses / (c.hits + c.misses));
+}
+
+template <typename F>
+void run(const char* name, texture_cache& cache, F lookups) {
+    cache.reset_stats();
+    long count = 0;
+    double elapsed = 0;
+    vec3 sink(0, 0, 0);
+    auto start = chrono::steady_clock::now();
+    do {
+        count += lookups(sink);
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (elapsed < 0.5);
+    if (sink[0] < 0)
+        cout << sink;
+    texture_cache::counters c = cache.stats();
+    printf("  %-9s %6.2f Mlookups/s, %6.2f%% of tile reads missed, %6.1f MiB of tiles resident, process %6.1f MiB\n",
+           name, count / elapsed / 1e6, 100.0 * c.misses / (c.hits + c.misses), cache.resident_bytes() / 1048576.0,
+           resident_mib());
+}
+
+int main() {
+    texture_cache cache;
+    {
+        // Bands of colour with fine detail, so levels differ.
+        vector<uint8_t> rgb(size_t(side) * side * 3);
+        for (int y = 0; y < side; y++) {
+            for (int x = 0; x < side; x++) {
+                uint8_t* p = &rgb[(size_t(y) * side + x) * 3];
+                p[0] = x * 255 / side;
+                p[1] = ((x ^ y) & 8) ? 200 : 40;
+                p[2] = y * 255 / side;
+            }
+        }
+        string error;
+        auto start = chrono::steady_clock::now();
+        if (cache.add(rgb.data(), side, side, error) < 0) {
+            cerr << error << "\n";
+            return 1;
+        }
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        printf("%dx%d texture, %d levels, %.1f MiB of tiles stored in %.0f ms\n", side, side, cache.level_count(0),
+               cache.stored_bytes() / 1048576.0, ms);
+    }
+    printf("process %.1f MiB with the image freed\n", resident_mib());
+
+    vector<real> random_uv(1 << 20);
+    for (real& x : random_uv)
+        x = random_double();
+
+    for (size_t mib : { 4, 16, 64, 128 }) {
+        cache.set_budget(mib << 20);
+        printf("budget %zu MiB\n", mib);
+        run("coherent", cache, [&](vec3& sink) { return coherent(cache, 0, 1, sink); });
+        run("random", cache, [&](vec3& sink) {
+            for (size_t k = 0; k + 1 < random_uv.size(); k += 2)
+                sink += cache.sample(0, random_uv[k], random_uv[k + 1], 0);
+            return long(random_uv.size() / 2);
+        });
+    }
+
+    cache.set_budget(size_t(64) << 20);
+    int cores = max(1, int(thread::hardware_concurrency()));
+    printf("threads, budget 64 MiB, %d cores\n", cores);
+    for (int n = 1; n < cores; n *= 2)
+        run_threads(cache, n);
+    run_threads(cache, cores);
+}
@@ -0,0 +1,162 @@
+#ifndef BVHH
+#define BVHH
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "hitable.h"
+
+// A primitive as the BVH builders see it: its box, the box centre used for
+// binning, and its position in the caller's primitive array.
+struct bvh_primitive {
+    aabb box;
+    vec3 centroid;
+    int index;
+};
+
+inline std::vector<bvh_primitive> make_bvh_primitives(hitable **l, int n) {
+    std::vector<bvh_primitive> prims(n);
+    for (int i = 0; i < n; i++) {
+        prims[i].box = l[i]->bounding_box();
+        prims[i].centroid = prims[i].box.centroid();
+        prims[i].index = i;
+    }
+    return prims;
+}
+
+// Surface area heuristic split of prims[start, end). Centroids are dropped
+// into bins along each axis and the cheapest boundary between bins wins,
+// where a split costs SA(left)*N(left) + SA(right)*N(right). The range is
+// partitioned in place and the first index of the right half is returned.
+// cost receives the expected number of primitive tests below the split,
+// i.e. the split cost divided by SA(parent). Returns -1 when all centroids
+// coincide and no plane separates them. axis receives the split axis.
+inline int sah_partition(std::vector<bvh_primitive>& prims, int start, int end, double& cost, int& axis) {
+    const int nbins = 16;
+
+    aabb bounds;
+    interval centroid_bounds[3];
+    for (int i = start; i < end; i++) {
+        bounds = aabb(bounds, prims[i].box);
+        for (int axis = 0; axis < 3; axis++) {
+            double c = prims[i].centroid[axis];
+            centroid_bounds[axis] = interval(centroid_bounds[axis], interval(c, c));
+        }
+    }
+
+    double best_cost = std::numeric_limits<double>::infinity();
+    int best_axis = -1;
+    int best_bin = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+        const interval& cb = centroid_bounds[axis];
+        double extent = cb.size();
+        if (extent <= 0)
+            continue;
+
+        aabb bin_box[nbins];
+        int bin_count[nbins] = {};
+        for (int i = start; i < end; i++) {
+            int b = int(nbins * (prims[i].centroid[axis] - cb.min) / extent);
+            if (b >= nbins) b = nbins - 1;
+            bin_box[b] = aabb(bin_box[b], prims[i].box);
+            bin_count[b]++;
+        }
+
+        // Sweep from the right to get the cost of everything past each boundary,
+        // then from the left to combine it with the near side.
+        double right_cost[nbins];
+        aabb right_box;
+        int right_count = 0;
+        for (int b = nbins - 1; b > 0; b--) {
+            right_box = aabb(right_box, bin_box[b]);
+            right_count += bin_count[b];
+            right_cost[b] = right_count * right_box.surface_area();
+        }
+
+        aabb left_box;
+        int left_count = 0;
+        for (int b = 0; b < nbins - 1; b++) {
+            left_box = aabb(left_box, bin_box[b]);
+            left_count += bin_count[b];
+            if (left_count == 0 || left_count == end - start)
+                continue;
+            double c = left_count * left_box.surface_area() + right_cost[b + 1];
+            if (c < best_cost) {
+                best_cost = c;
+                best_axis = axis;
+                best_bin = b;
+            }
+        }
+    }
+
+    if (best_axis < 0)
+        return -1;
+
+    const interval& cb = centroid_bounds[best_axis];
+    double extent = cb.size();
+    auto first_right = std::partition(prims.begin() + start, prims.begin() + end,
+        [&](const bvh_primitive& p) {
+            int b = int(nbins * (p.centroid[best_axis] - cb.min) / extent);
+            if (b >= nbins) b = nbins - 1;
+            return b <= best_bin;
+        });
+
+    double area = bounds.surface_area();
+    cost = area > 0 ? best_cost / area : end - start;
+    axis = best_axis;
+    return int(first_right - prims.begin());
+}
+
+class bvh_node : public hitable {
+    public:
+        bvh_node(hitable **l, int n) {
+            std::vector<bvh_primitive> prims = make_bvh_primitives(l, n);
+            build(l, prims, 0, n);
+        }
+
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            if (!left || !bbox.hit(r, tmin, tmax))
+                return false;
+
+            bool hit_left = left->hit(r, tmin, tmax, rec);
+            bool hit_right = right != left && right->hit(r, tmin, hit_left ? rec.t : tmax, rec);
+            return hit_left || hit_right;
+        }
+
+        virtual aabb bounding_box() const { return bbox; }
+
+        hitable *left;   // both null when built from no primitives
+        hitable *right;
+        aabb bbox;
+
+    private:
+        bvh_node(hitable **l, std::vector<bvh_primitive>& prims, int start, int end) {
+            build(l, prims, start, end);
+        }
+
+        void build(hitable **l, std::vector<bvh_primitive>& prims, int start, int end) {
+            int n = end - start;
+            if (n == 0) {
+                // Only the root can be empty; splits never leave a side so.
+                left = right = nullptr;
+                return;
+            } else if (n == 1) {
+                left = right = l[prims[start].index];
+            } else if (n == 2) {
+                left = l[prims[start].index];
+                right = l[prims[start + 1].index];
+            } else {
+                double cost;
+                int axis;
+                int mid = sah_partition(prims, start, end, cost, axis);
+                if (mid < 0)
+                    mid = start + n/2; // coincident centroids, any split is as good
+                left = new bvh_node(l, prims, start, mid);
+                right = new bvh_node(l, prims, mid, end);
+            }
+            bbox = aabb(left->bounding_box(), right->bounding_box());
+        }
+};
+
+#endif
@@ -19,10 +19,15 @@
                 horizontal = 2*half_width*u;
                 vertical = 2*half_height*v;
             }
-            ray get_ray(float s, float t) {
+            ray get_ray(real s, real t) const {
                 return ray(origin,
                            lower_left_corner + s*horizontal + t*vertical - origin);
             }
+            // The angle between neighbouring rays at the centre of an image
+            // ny pixels high; the image plane is at distance 1.
+            real pixel_spread(int ny) const {
+                return vertical.length() / ny;
+            }
 
             vec3 origin;
             vec3 lower_left_corner;
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <fstream>
 #include "ray.h"
+#include "image.h"
 using namespace std;
 
 bool hit_sphere(const vec3& center, float radius, const ray& r){
@@ -40,9 +41,7 @@ vec3 color(const ray& r) {
 int main(){
     int nx = 200;
     int ny = 100;
-    ofstream myfile;
-    myfile.open ("output.ppm");
-    myfile << "P3\n" << nx << " " << ny << "\n255\n";
+    image img(nx, ny);
     vec3 lower_left_corner(-2.0, -1.0, -1.0);
     vec3 horizontal(4.0, 0.0, 0.0);
     vec3 vertical(0.0, 2.0, 0.0);
@@ -53,11 +52,8 @@ int main(){
             float v = float(j) / float(ny);
             ray r(origin, lower_left_corner + u*horizontal + v*vertical);
             vec3 col = color(r);
-            int ir = int(255.99*col[0]);
-            int ig = int(255.99*col[1]);
-            int ib = int(255.99*col[2]);
-            myfile << ir << " " << ig << " " << ib << "\n";
+            img.at(i, j) = col;
         }
     }
-    myfile.close();
+    write_image("output.ppm", img, false);
 }
\ No newline at end of file
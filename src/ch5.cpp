@@ -5,88 +5,259 @@
 #include "float.h"
 #include "camera.h"
 #include "random.h"
-#include "material.h"
+#include "materials.h"
 #include "lambertian.h"
 #include "metal.h"
 #include "dielectric.h"
+#include "linear_bvh.h"
+#include "packet.h"
+#include "integrator.h"
+#include "wavefront.h"
+#include "adaptive.h"
+#include "progressive.h"
+#include "image.h"
+#include "scenes.h"
+#include "scene_file.h"
+#include "triangle_mesh.h"
+#include "tile_renderer.h"
 
 using namespace std;
 
-vec3 color(const ray& r, hitable *world, int depth) {
-        hit_record rec;
-        if (world->hit(r, 0.001, MAXFLOAT, rec)) {
-            ray scattered;
-            vec3 attenuation;
-            if (depth < 50 && rec.mat_ptr->scatter(r, rec, attenuation, scattered)) {
-                return attenuation*color(scattered, world, depth+1);
-            }
-            else {
-                return vec3(0,0,0);
-            }
+// Packet mode: the camera rays for a pixel's samples are traced together,
+// packet_size at a time. After the first bounce the rays diverge, so each
+// one carries on alone through color().
+const int packet_size = 8;
+
+vec3 color_packet(const ray_packet<packet_size>& p, int count, linear_bvh *world,
+                  const material_table& materials, bool roulette, real spread) {
+    hit_record recs[packet_size];
+    uint32_t active = count == 32 ? ~0u : (1u << count) - 1;
+    uint32_t hits = hit_packet(*world, p, active, 0.001, MAXFLOAT, recs);
+    vec3 col(0, 0, 0);
+    for (int k = 0; k < count; k++) {
+        if (hits & (1u << k)) {
+            col += color_from_hit(p.rays[k], recs[k], world, materials, 0, roulette, ray_cone{ 0, spread });
         }
         else {
-            vec3 unit_direction = unit_vector(r.direction());
-            float t = 0.5*(unit_direction.y() + 1.0);
-            return (1.0-t)*vec3(1.0, 1.0, 1.0) + t*vec3(0.5, 0.7, 1.0);
-        }
-    }
-
-hitable* random_scene(){
-    int n = 500;
-    hitable** list = new hitable*[n+1];
-    list[0] = new sphere(vec3(0,-1000,0), 1000, new lambertian(vec3(0.5, 0.5, 0.5)));
-    int i = 1;
-    for(int a = -11; a < 11; a++){
-        for(int b = -11; b < 11; b++){
-            float choose_mat = random_double();
-            vec3 center(a+0.9*random_double(), 0.2, b+0.9*random_double());
-            if((center-vec3(4,0.2,0)).length() > 0.9){
-                if(choose_mat < 0.8){
-                    list[i++] = new sphere(center, 0.2, new lambertian(vec3(random_double()*random_double(), random_double()*random_double(), random_double()*random_double())));
-                }
-                else if(choose_mat < 0.95){
-                    list[i++] = new sphere(center, 0.2, new metal(vec3(0.5*(1 + random_double()), 0.5*(1 + random_double()), 0.5*(1 + random_double()))));
-                }
-                else{
-                    list[i++] = new sphere(center, 0.2, new dielectric(1.5));
-                }
-            }
+            thread_path_stats().record(0, PATH_ESCAPED);
+            col += sky(p.rays[k]);
         }
     }
-    
-    list[i++] = new sphere(vec3(0, 1, 0), 1.0, new dielectric(1.5));
-    list[i++] = new sphere(vec3(-4, 1, 0), 1.0, new lambertian(vec3(0.4, 0.2, 0.1)));
-    list[i++] = new sphere(vec3(4, 1, 0), 1.0, new metal(vec3(0.7, 0.6, 0.5)));
-
-    return new hitable_list(list, i);
+    return col;
 }
 
-int main(){
+int main(int argc, char** argv){
     int nx = 400;
     int ny = 200;
     int ns = 200;
-    ofstream myfile;
-    myfile.open ("output.ppm");
-    myfile << "P3\n" << nx << " " << ny << "\n255\n";
-    hitable *world = random_scene();
+    int nthreads = 0;
+    bool packets = false;
+    bool wavefront = false;
+    bool roulette = true;
+    bool stats = false;
+    bool adaptive = false;
+    bool heatmap = false;
+    string output = "output.ppm";
+    bool deep = false;
+    bool progressive = false;
+    string checkpoint;
+    string scene_path;
+    string obj_path;
+    int instanced_extent = 0;
+    int checkpoint_every = 10;
+    int texture_mb = 0;
+    adaptive_settings adaptive_opts;
+    for (int a = 1; a < argc; a++) {
+        string arg = argv[a];
+        if (arg == "-t" && a+1 < argc)
+            nthreads = atoi(argv[++a]);
+        else if (arg == "-s" && a+1 < argc)
+            ns = max(1, atoi(argv[++a]));
+        else if (arg == "-packets")
+            packets = true;
+        else if (arg == "-wavefront")
+            wavefront = true;
+        else if (arg == "-no-roulette")
+            roulette = false;
+        else if (arg == "-stats")
+            stats = true;
+        else if (arg == "-adaptive")
+            adaptive = true;
+        else if (arg == "-threshold" && a+1 < argc)
+            adaptive_opts.threshold = atof(argv[++a]);
+        else if (arg == "-heatmap")
+            heatmap = true;
+        else if (arg == "-scene" && a+1 < argc)
+            scene_path = argv[++a];
+        else if (arg == "-texture-mb" && a+1 < argc)
+            texture_mb = max(1, atoi(argv[++a]));
+        else if (arg == "-obj" && a+1 < argc)
+            obj_path = argv[++a];
+        else if (arg == "-instanced" && a+1 < argc)
+            instanced_extent = max(1, atoi(argv[++a]));
+        else if (arg == "-o" && a+1 < argc)
+            output = argv[++a];
+        else if (arg == "-deep")
+            deep = true;
+        else if (arg == "-progressive")
+            progressive = true;
+        else if (arg == "-checkpoint" && a+1 < argc)
+            checkpoint = argv[++a];
+        else if (arg == "-every" && a+1 < argc)
+            checkpoint_every = max(1, atoi(argv[++a]));
+        else {
+            cerr << "usage: " << argv[0] << " [-t threads] [-s samples] [-packets | -wavefront] [-no-roulette] [-stats]\n"
+                 << "       [-adaptive [-threshold err] [-heatmap]]\n"
+                 << "       [-progressive [-checkpoint file] [-every passes]]\n"
+                 << "       [-scene file [-texture-mb budget] | -instanced extent] [-obj mesh.obj]\n"
+                 << "       [-o image.{ppm,png,pfm}] [-deep]\n"
+                 << "-heatmap writes the adaptive sample counts to <output stem>.samples.ppm\n";
+            return 1;
+        }
+    }
+    uint64_t seed = 1;
     camera cam(vec3(-2,2,1), vec3(0,0,-1), vec3(0,1,0),90, float(nx)/float(ny));
-    for(int j = ny-1; j>=0; j--){
-        for(int i=0; i<nx; i++){
+    scene *objects;
+    if (instanced_extent > 0)
+        objects = instanced_scene(instanced_extent);
+    else if (scene_path.empty())
+        objects = random_scene();
+    else {
+        bool has_camera;
+        scene_camera c;
+        string error;
+        objects = load_scene(scene_path, has_camera, c, error);
+        if (!objects) {
+            cerr << error << "\n";
+            return 1;
+        }
+        if (has_camera)
+            cam = make_camera(c, float(nx)/float(ny));
+    }
+    if (!obj_path.empty()) {
+        // The mesh goes into the scene as it is in the file, in grey.
+        vector<vec3> vertices;
+        vector<int32_t> indices;
+        string error;
+        if (!read_obj(obj_path, vertices, indices, error)) {
+            cerr << error << "\n";
+            return 1;
+        }
+        objects->add<triangle_mesh>(std::move(vertices), std::move(indices),
+                                    objects->make_material<lambertian>(vec3(0.5, 0.5, 0.5)));
+    }
+    if (texture_mb > 0)
+        objects->textures.set_budget(size_t(texture_mb) << 20);
+    linear_bvh *world = new linear_bvh(objects->list, objects->list_size);
+    const material_table& materials = objects->materials;
+    real spread = cam.pixel_spread(ny);
+    image framebuffer(nx, ny);
+    tile_renderer renderer(nx, ny, 16, nthreads);
+    if (wavefront) {
+        renderer.render_tiles([&](const tile& t) {
+            vector<vec3> radiance((t.x1 - t.x0)*(t.y1 - t.y0), vec3(0, 0, 0));
+            vector<wavefront_path> paths = camera_paths(cam, t, nx, ny, ns, seed);
+            wavefront_integrator(world, materials, roulette).trace(paths, radiance.data());
+            for (int j = t.y0; j < t.y1; j++) {
+                for (int i = t.x0; i < t.x1; i++) {
+                    framebuffer.at(i, j) = radiance[(j - t.y0)*(t.x1 - t.x0) + (i - t.x0)] / float(ns);
+                }
+            }
+        });
+    }
+    else if (progressive) {
+        // One sample per pixel per pass. Every checkpoint_every passes the
+        // accumulation buffer is checkpointed and the image so far written,
+        // so a preempted job rerun with the same arguments resumes.
+        if (checkpoint.empty())
+            checkpoint = output + ".ckpt";
+        progressive_renderer progress(nx, ny, seed);
+        if (progress.load_checkpoint(checkpoint))
+            cerr << "resuming from " << checkpoint << " at pass " << progress.passes << "\n";
+        while (progress.passes < ns) {
+            progress.render_pass([&](int i, int j) {
+                float u = float(i + random_double()) / float(nx);
+                float v = float(j + random_double()) / float(ny);
+                return color(cam.get_ray(u, v), world, materials, roulette, spread);
+            }, renderer);
+            if (progress.passes % checkpoint_every == 0 || progress.passes == ns) {
+                if (!progress.save_checkpoint(checkpoint))
+                    cerr << "could not write checkpoint " << checkpoint << "\n";
+                progress.resolve(framebuffer);
+                write_image(output, framebuffer, image_format_for(output, deep));
+            }
+        }
+        progress.resolve(framebuffer);
+    }
+    else if (adaptive) {
+        adaptive_sampler sampler(nx, ny, adaptive_opts);
+        sampler.render([&](int i, int j) {
+            float u = float(i + random_double()) / float(nx);
+            float v = float(j + random_double()) / float(ny);
+            return color(cam.get_ray(u, v), world, materials, roulette, spread);
+        }, renderer, ns, seed);
+        int most = 0;
+        for (int j = 0; j < ny; j++) {
+            for (int i = 0; i < nx; i++) {
+                framebuffer.at(i, j) = sampler.pixel(i, j).mean;
+                most = max(most, sampler.pixel(i, j).n);
+            }
+        }
+        cerr << "adaptive: " << sampler.total_samples() << " samples, "
+             << double(sampler.total_samples()) / (nx*ny) << " per pixel, max " << most << "\n";
+        if (heatmap) {
+            image heat(nx, ny);
+            for (int j = 0; j < ny; j++)
+                for (int i = 0; i < nx; i++)
+                    heat.at(i, j) = heat_color(double(sampler.pixel(i, j).n) / most);
+            // Named after the output, so renders sharing a directory keep
+            // their own.
+            size_t dot = output.rfind('.');
+            if (dot != string::npos && output.find('/', dot) != string::npos)
+                dot = string::npos;
+            string heat_path = output.substr(0, dot) + ".samples.ppm";
+            if (!write_image(heat_path, heat, false))
+                cerr << "could not write " << heat_path << "\n";
+        }
+    }
+    else {
+        renderer.render([&](int i, int j) {
             vec3 col(0, 0, 0);
-            for (int s=0; s < ns; s++) {
+            if (packets) {
+                ray_packet<packet_size> p;
+                for (int s=0; s < ns; s += packet_size) {
+                    int count = min(packet_size, ns - s);
+                    for (int k = 0; k < count; k++) {
+                        float u = float(i + random_double()) / float(nx);
+                        float v = float(j + random_double()) / float(ny);
+                        p.set(k, cam.get_ray(u, v));
+                    }
+                    col += color_packet(p, count, world, materials, roulette, spread);
+                }
+            }
+            else {
+                for (int s=0; s < ns; s++) {
                     float u = float(i + random_double()) / float(nx);
                     float v = float(j + random_double()) / float(ny);
                     ray r = cam.get_ray(u, v);
-                    vec3 p = r.point_at_parameter(2.0);
-                    col += color(r, world, 0);
+                    col += color(r, world, materials, roulette, spread);
                 }
-                col /= float(ns);
-                col = vec3( sqrt(col[0]), sqrt(col[1]), sqrt(col[2]) );
-            int ir = int(255.99*col[0]);
-            int ig = int(255.99*col[1]);
-            int ib = int(255.99*col[2]);
-            myfile << ir << " " << ig << " " << ib << "\n";
+            }
+            return col / float(ns);
+        }, framebuffer.pixels, seed);
+    }
+    if (!write_image(output, framebuffer, image_format_for(output, deep))) {
+        cerr << "could not write " << output << "\n";
+        return 1;
+    }
+    if (stats) {
+        collect_path_stats().print(cerr);
+        if (objects->textures.texture_count() > 0) {
+            const texture_cache& textures = objects->textures;
+            texture_cache::counters c = textures.stats();
+            cerr << "textures: " << c.hits + c.misses << " tile lookups, " << c.misses << " misses, "
+                 << textures.resident_bytes() / 1048576.0 << " of " << textures.budget() / 1048576.0
+                 << " MiB resident, " << textures.stored_bytes() / 1048576.0 << " MiB stored\n";
         }
     }
-    myfile.close();
 }
\ No newline at end of file
@@ -1,20 +1,56 @@
 #ifndef HITABLE
 #define HITABLE
 
+#include <cmath>
+#include <cstdint>
 #include "ray.h"
+#include "aabb.h"
 
-class material;
+enum uv_mapping : uint8_t {
+    UV_NONE,    // no parametrization
+    UV_GIVEN,   // u, v and uv_length are filled in
+    UV_SPHERE   // worked out from the normal; uv_length holds the radius
+};
 
 struct hit_record {
-    float t;
+    real t;
     vec3 p;
     vec3 normal;
-    material *mat_ptr;
+    int mat_id;     // index into the scene's material_table
+    // Where u, v and uv_length below come from; see surface_uv().
+    uv_mapping mapping = UV_NONE;
+    real u = 0, v = 0;
+    real uv_length = 0;
+    // Width of the ray's footprint at p in world units, filled in by the
+    // integrator from the ray's cone; 0 means a single point.
+    real footprint = 0;
 };
 
+// The surface parameters of a hit for textures, and uv_length, the world
+// space length of a unit step in them (the geometric mean over u and v),
+// which converts a footprint to texture space. Spheres only record their
+// radius in uv_length and leave the trig to here, as it costs more than
+// the rest of the hit and only textured materials want it.
+inline void surface_uv(const hit_record& rec, real& u, real& v, real& uv_length) {
+    if (rec.mapping == UV_SPHERE) {
+        // Longitude and latitude, v = 0 at the bottom pole. A step in u
+        // covers 2 pi r sin(theta) and one in v pi r.
+        const vec3& n = rec.normal;
+        real y = std::fmax(real(-1), std::fmin(real(1), n.y()));
+        u = (std::atan2(-n.z(), n.x()) + real(M_PI)) * real(0.5 / M_PI);
+        v = std::acos(-y) * real(1 / M_PI);
+        uv_length = real(M_PI) * rec.uv_length * std::sqrt(2*std::sqrt(1 - y*y));
+    } else {
+        u = rec.u;
+        v = rec.v;
+        uv_length = rec.mapping == UV_NONE ? 0 : rec.uv_length;
+    }
+}
+
 class hitable {
 public:
-    virtual bool hit(const ray& r, float t_min, float t_max, hit_record& rec) const = 0;
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const = 0;
+    virtual aabb bounding_box() const = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,22 @@
+#include "hitablelist.h"
+
+bool hitable_list::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+    hit_record temp_rec;
+    bool hit_anything = false;
+    real closest_so_far = t_max;
+    for (int i = 0; i < list_size; i++) {
+        if (list[i]->hit(r, t_min, closest_so_far, temp_rec)) {
+            hit_anything = true;
+            closest_so_far = temp_rec.t;
+            rec = temp_rec;
+        }
+    }
+    return hit_anything;
+}
+
+aabb hitable_list::bounding_box() const {
+    aabb box;
+    for (int i = 0; i < list_size; i++)
+        box = aabb(box, list[i]->bounding_box());
+    return box;
+}
@@ -0,0 +1,229 @@
+#ifndef IMAGEH
+#define IMAGEH
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "png.h"
+#include "vec3.h"
+
+// An in-memory float framebuffer. Pixel (i, j) is at pixels[j*width + i]
+// with j = 0 the bottom row, the way the renderers loop over the image.
+class image {
+    public:
+        image() : width(0), height(0) {}
+        image(int width, int height)
+            : width(width), height(height), pixels(width*height, vec3(0, 0, 0)) {}
+
+        vec3& at(int i, int j) { return pixels[j*width + i]; }
+        const vec3& at(int i, int j) const { return pixels[j*width + i]; }
+
+        int width, height;
+        std::vector<vec3> pixels;
+};
+
+enum image_format {
+    IMAGE_PPM_ASCII,  // P3, the old text format
+    IMAGE_PPM,        // binary P6, 8 bits per channel
+    IMAGE_PPM16,      // binary P6, 16 bits per channel
+    IMAGE_PFM,        // portable float map, linear 32 bit floats
+    IMAGE_PNG,        // 8 bits per channel
+    IMAGE_PNG16       // 16 bits per channel
+};
+
+// Picks a format from the file extension: .pfm, .png or (for anything else)
+// binary .ppm. deep selects the 16 bit variant of PPM and PNG.
+inline image_format image_format_for(const std::string& path, bool deep = false) {
+    auto ends_with = [&](const char* ext) {
+        size_t n = strlen(ext);
+        return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+    };
+    if (ends_with(".pfm"))
+        return IMAGE_PFM;
+    if (ends_with(".png"))
+        return deep ? IMAGE_PNG16 : IMAGE_PNG;
+    return deep ? IMAGE_PPM16 : IMAGE_PPM;
+}
+
+// Converts one channel to an integer sample in [0, max_value]. With gamma
+// the value is treated as linear and gets the gamma 2 transform first.
+inline int quantize(float c, int max_value, bool gamma) {
+    if (gamma)
+        c = c > 0 ? std::sqrt(c) : 0;
+    int v = int((max_value + 0.99) * c);
+    return v < 0 ? 0 : (v > max_value ? max_value : v);
+}
+
+// Samples of the whole image, top row first, as the integer formats want
+// them. 16 bit samples are stored big endian.
+inline std::vector<uint8_t> image_samples(const image& img, int bits, bool gamma) {
+    int max_value = (1 << bits) - 1;
+    int bytes = bits / 8;
+    std::vector<uint8_t> out(size_t(img.width) * img.height * 3 * bytes);
+    uint8_t* p = out.data();
+    for (int j = img.height-1; j >= 0; j--) {
+        for (int i = 0; i < img.width; i++) {
+            const vec3& col = img.at(i, j);
+            for (int c = 0; c < 3; c++) {
+                int v = quantize(col[c], max_value, gamma);
+                if (bytes == 2)
+                    *p++ = v >> 8;
+                *p++ = v & 0xff;
+            }
+        }
+    }
+    return out;
+}
+
+// Writes img in the given format in one pass. Pixels hold linear values if
+// gamma is set, display values otherwise; PFM always stores them unchanged.
+// Returns false if the file could not be written.
+inline bool write_image(const std::string& path, const image& img, image_format format, bool gamma = true) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        return false;
+
+    std::string header;
+    std::vector<uint8_t> body;
+    switch (format) {
+        case IMAGE_PPM_ASCII: {
+            header = "P3\n" + std::to_string(img.width) + " " + std::to_string(img.height) + "\n255\n";
+            std::vector<uint8_t> samples = image_samples(img, 8, gamma);
+            body.reserve(samples.size() * 4);
+            for (size_t k = 0; k < samples.size(); k++) {
+                int v = samples[k];
+                if (v >= 100) body.push_back('0' + v / 100);
+                if (v >= 10) body.push_back('0' + v / 10 % 10);
+                body.push_back('0' + v % 10);
+                body.push_back(k % 3 == 2 ? '\n' : ' ');
+            }
+            break;
+        }
+        case IMAGE_PPM:
+        case IMAGE_PPM16: {
+            bool deep = format == IMAGE_PPM16;
+            header = "P6\n" + std::to_string(img.width) + " " + std::to_string(img.height)
+                   + (deep ? "\n65535\n" : "\n255\n");
+            body = image_samples(img, deep ? 16 : 8, gamma);
+            break;
+        }
+        case IMAGE_PFM: {
+            // A negative scale means little endian; rows run bottom to top,
+            // which is already our order.
+            header = "PF\n" + std::to_string(img.width) + " " + std::to_string(img.height) + "\n-1.0\n";
+            body.resize(img.pixels.size() * 3 * sizeof(float));
+            uint8_t* p = body.data();
+            for (const vec3& col : img.pixels) {
+                for (int c = 0; c < 3; c++) {
+                    float v = col[c];
+                    uint32_t bits;
+                    memcpy(&bits, &v, 4);
+                    *p++ = bits; *p++ = bits >> 8; *p++ = bits >> 16; *p++ = bits >> 24;
+                }
+            }
+            break;
+        }
+        case IMAGE_PNG:
+        case IMAGE_PNG16: {
+            int bits = format == IMAGE_PNG16 ? 16 : 8;
+            std::vector<uint8_t> samples = image_samples(img, bits, gamma);
+            body = encode_png(samples.data(), img.width, img.height, bits);
+            break;
+        }
+    }
+
+    out.write(header.data(), header.size());
+    out.write(reinterpret_cast<const char*>(body.data()), body.size());
+    return bool(out);
+}
+
+inline bool write_image(const std::string& path, const image& img, bool gamma = true) {
+    return write_image(path, img, image_format_for(path), gamma);
+}
+
+// Reads an 8 bit RGB image: PPM (P3 or P6, any maximum value, scaled to
+// 255) or PNG, told apart by the magic number. Samples are stored as in
+// the file, top row first and without any gamma transform. On failure
+// returns false with the reason in error.
+inline bool read_image(const std::string& path, std::vector<uint8_t>& rgb, int& width, int& height,
+                       std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!in && !in.eof()) {
+        error = "could not read " + path;
+        return false;
+    }
+    if (data.size() >= 8 && data[0] == 0x89 && data[1] == 'P') {
+        if (!decode_png(data.data(), data.size(), rgb, width, height, error)) {
+            error = path + ": " + error;
+            return false;
+        }
+        return true;
+    }
+    if (data.size() < 2 || data[0] != 'P' || (data[1] != '3' && data[1] != '6')) {
+        error = path + " is not a PPM or PNG image";
+        return false;
+    }
+
+    // The header is three numbers separated by whitespace and comments,
+    // then one whitespace character before binary samples.
+    size_t pos = 2;
+    auto number = [&](long& value) {
+        while (pos < data.size()) {
+            if (data[pos] == '#')
+                while (pos < data.size() && data[pos] != '\n')
+                    pos++;
+            else if (isspace(data[pos]))
+                pos++;
+            else
+                break;
+        }
+        if (pos == data.size() || !isdigit(data[pos]))
+            return false;
+        value = 0;
+        while (pos < data.size() && isdigit(data[pos]) && value < (1 << 24))
+            value = 10*value + (data[pos++] - '0');
+        return true;
+    };
+    long w, h, max_value;
+    if (!number(w) || !number(h) || !number(max_value) || w <= 0 || h <= 0 || w >= (1 << 24) || h >= (1 << 24)
+        || max_value <= 0 || max_value > 65535) {
+        error = path + ": bad PPM header";
+        return false;
+    }
+    width = int(w);
+    height = int(h);
+    size_t count = size_t(w) * h * 3;
+    bool ascii = data[1] == '3';
+    int bytes = max_value > 255 ? 2 : 1;
+    pos++;
+    // Checked before allocating, so a bad header can't ask for terabytes.
+    // An ASCII sample takes at least a byte too.
+    if (data.size() < pos + count*(ascii ? 1 : bytes)) {
+        error = path + " is truncated";
+        return false;
+    }
+    rgb.resize(count);
+    for (size_t k = 0; k < count; k++) {
+        long v;
+        if (ascii) {
+            if (!number(v)) {
+                error = path + " is truncated";
+                return false;
+            }
+        } else {
+            v = bytes == 2 ? (data[pos] << 8) | data[pos + 1] : data[pos];
+            pos += bytes;
+        }
+        rgb[k] = uint8_t((std::min(v, max_value) * 255 + max_value/2) / max_value);
+    }
+    return true;
+}
+
+#endif
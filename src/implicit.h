@@ -0,0 +1,107 @@
+#ifndef IMPLICITH
+#define IMPLICITH
+
+#include <cmath>
+#include "hitable.h"
+#include "polynomial.h"
+
+// Picks the root finder implicit surfaces use: the smallest root of the
+// degree n polynomial c inside (lo, hi).
+typedef bool (*polynomial_root_fn)(const double* c, int n, double lo, double hi, double& t);
+
+// A surface f(p) = 0 where f is a polynomial, negative inside and
+// positive outside, so its gradient is the outward normal. A subclass
+// gives the polynomial in t that f(o + t*d) is along a ray, the gradient,
+// and a box that holds the whole surface.
+//
+// The ray is first clipped to the box and its origin moved up to where it
+// enters, which keeps the polynomial's coefficients near the size of the
+// surface rather than of the ray's distance to it.
+class implicit_surface : public hitable {
+    public:
+        // Writes the coefficients of f(o + t*d), constant term first, and
+        // returns the degree.
+        virtual int ray_polynomial(const vec3& o, const vec3& d, double* c) const = 0;
+        virtual vec3 gradient(const vec3& p) const = 0;
+
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            aabb box = bounding_box();
+            double t0 = tmin, t1 = tmax;
+            for (int axis = 0; axis < 3; axis++) {
+                const interval& slab = box.axis_interval(axis);
+                double inv = 1.0 / r.direction()[axis];
+                double near = (slab.min - r.origin()[axis]) * inv;
+                double far = (slab.max - r.origin()[axis]) * inv;
+                if (inv < 0) {
+                    double tmp = near; near = far; far = tmp;
+                }
+                t0 = std::fmax(t0, near);
+                t1 = std::fmin(t1, far);
+                if (t1 <= t0)
+                    return false;
+            }
+
+            double c[max_polynomial_degree + 1];
+            int n = ray_polynomial(r.point_at_parameter(t0), r.direction(), c);
+            double t;
+            if (!solver(c, n, 0, t1 - t0, t))
+                return false;
+            t += t0;
+            if (t <= tmin || t >= tmax)
+                return false;
+            rec.t = t;
+            rec.p = r.point_at_parameter(rec.t);
+            rec.normal = unit_vector(gradient(rec.p));
+            rec.mat_id = mat_id;
+            rec.mapping = UV_NONE;
+            return true;
+        }
+
+        // Benchmarks may switch it to compare root finders.
+        inline static polynomial_root_fn solver = first_root_closed_form;
+
+        int mat_id = 0;
+};
+
+// A ring around an axis through center parallel to y: the points at
+// distance minor from the circle of radius major in the xz plane.
+// f = (|p|^2 + major^2 - minor^2)^2 - 4 major^2 (x^2 + z^2), a quartic.
+class torus : public implicit_surface {
+    public:
+        torus(const vec3& center, real major, real minor, int mat_id)
+            : center(center), major(major), minor(minor) {
+            this->mat_id = mat_id;
+        }
+
+        virtual int ray_polynomial(const vec3& origin, const vec3& d, double* c) const {
+            vec3 o = origin - center;
+            double dd = dot(d, d), od = dot(o, d);
+            double g = double(dot(o, o)) + double(major)*major - double(minor)*minor;
+            double k = 4.0*major*major;
+            double dxz = double(d[0])*d[0] + double(d[2])*d[2];
+            double oxz = double(o[0])*d[0] + double(o[2])*d[2];
+            double xz = double(o[0])*o[0] + double(o[2])*o[2];
+            c[4] = dd*dd;
+            c[3] = 4*dd*od;
+            c[2] = 4*od*od + 2*dd*g - k*dxz;
+            c[1] = 4*od*g - 2*k*oxz;
+            c[0] = g*g - k*xz;
+            return 4;
+        }
+
+        virtual vec3 gradient(const vec3& p) const {
+            vec3 o = p - center;
+            real s = dot(o, o) + major*major - minor*minor;
+            return 4*s*o - 8*major*major*vec3(o[0], 0, o[2]);
+        }
+
+        virtual aabb bounding_box() const {
+            vec3 reach(major + minor, minor, major + minor);
+            return aabb(center - reach, center + reach);
+        }
+
+        vec3 center;
+        real major, minor;
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef INSTANCEH
+#define INSTANCEH
+
+#include <cmath>
+#include <limits>
+#include "hitable.h"
+
+// An affine map p -> m*p + t, stored as the three rows of [m | t].
+struct affine_transform {
+    real m[3][4];
+
+    static affine_transform identity() { return scaling(1); }
+
+    static affine_transform translation(const vec3& t) {
+        affine_transform a = identity();
+        for (int i = 0; i < 3; i++)
+            a.m[i][3] = t[i];
+        return a;
+    }
+
+    static affine_transform scaling(real s) {
+        affine_transform a = {};
+        for (int i = 0; i < 3; i++)
+            a.m[i][i] = s;
+        return a;
+    }
+
+    // Counter-clockwise about +y, seen from above.
+    static affine_transform rotation_y(real degrees) {
+        real theta = degrees * real(M_PI / 180);
+        real c = std::cos(theta), s = std::sin(theta);
+        affine_transform a = identity();
+        a.m[0][0] = c;  a.m[0][2] = s;
+        a.m[2][0] = -s; a.m[2][2] = c;
+        return a;
+    }
+
+    vec3 point(const vec3& p) const {
+        return vec3(m[0][0]*p[0] + m[0][1]*p[1] + m[0][2]*p[2] + m[0][3],
+                    m[1][0]*p[0] + m[1][1]*p[1] + m[1][2]*p[2] + m[1][3],
+                    m[2][0]*p[0] + m[2][1]*p[1] + m[2][2]*p[2] + m[2][3]);
+    }
+
+    vec3 vector(const vec3& v) const {
+        return vec3(m[0][0]*v[0] + m[0][1]*v[1] + m[0][2]*v[2],
+                    m[1][0]*v[0] + m[1][1]*v[1] + m[1][2]*v[2],
+                    m[2][0]*v[0] + m[2][1]*v[1] + m[2][2]*v[2]);
+    }
+
+    // Multiplies by the transpose of m. For the inverse of a transform,
+    // this carries normals the way the transform itself carries points.
+    vec3 transposed_vector(const vec3& v) const {
+        return vec3(m[0][0]*v[0] + m[1][0]*v[1] + m[2][0]*v[2],
+                    m[0][1]*v[0] + m[1][1]*v[1] + m[2][1]*v[2],
+                    m[0][2]*v[0] + m[1][2]*v[1] + m[2][2]*v[2]);
+    }
+
+    // Applies b first, then this.
+    affine_transform operator*(const affine_transform& b) const {
+        affine_transform a;
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 4; j++)
+                a.m[i][j] = m[i][0]*b.m[0][j] + m[i][1]*b.m[1][j] + m[i][2]*b.m[2][j] + (j == 3 ? m[i][3] : 0);
+        return a;
+    }
+
+    // m must be invertible.
+    affine_transform inverse() const {
+        // The inverse of m is its adjugate over its determinant; the
+        // adjugate's rows are cross products of m's columns.
+        vec3 c0(m[0][0], m[1][0], m[2][0]), c1(m[0][1], m[1][1], m[2][1]), c2(m[0][2], m[1][2], m[2][2]);
+        vec3 r0 = cross(c1, c2), r1 = cross(c2, c0), r2 = cross(c0, c1);
+        real inv_det = real(1) / dot(c0, r0);
+        affine_transform a;
+        for (int j = 0; j < 3; j++) {
+            a.m[0][j] = r0[j] * inv_det;
+            a.m[1][j] = r1[j] * inv_det;
+            a.m[2][j] = r2[j] * inv_det;
+        }
+        vec3 t = a.vector(vec3(m[0][3], m[1][3], m[2][3]));
+        for (int i = 0; i < 3; i++)
+            a.m[i][3] = -t[i];
+        return a;
+    }
+};
+
+// A placed copy of a hitable that is shared rather than copied: a sphere,
+// a triangle_mesh, or a whole linear_bvh of them. Rays are carried into
+// the object's space and its hits back out, so one object can be placed
+// any number of times for the cost of a transform each. A linear_bvh over
+// instances makes a two-level tree, with each object's own tree below it.
+//
+// Only the world-to-object transform is kept, since that is the one rays
+// need; bounding_box() inverts it, but that only happens while building.
+// Direction is transformed without normalizing so the t of a hit is the
+// same in both spaces.
+class instance : public hitable {
+    public:
+        // mat_id replaces the object's materials unless it is negative.
+        instance(const hitable* object, const affine_transform& object_to_world, int mat_id = -1)
+            : object(object), world_to_object(object_to_world.inverse()), mat_id(mat_id) {
+            // How much the transform scales lengths, on average over
+            // directions, for carrying uv_length out of the object.
+            const real (&m)[3][4] = object_to_world.m;
+            real det = m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1]) - m[0][1]*(m[1][0]*m[2][2] - m[1][2]*m[2][0])
+                     + m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+            scale = std::cbrt(std::fabs(det));
+        }
+
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            ray local(world_to_object.point(r.origin()), world_to_object.vector(r.direction()));
+            if (!object->hit(local, tmin, tmax, rec))
+                return false;
+            if (rec.mapping != UV_NONE) {
+                // Sphere parameters come from the normal, so settle them
+                // while it is still in object space.
+                surface_uv(rec, rec.u, rec.v, rec.uv_length);
+                rec.mapping = UV_GIVEN;
+                rec.uv_length *= scale;
+            }
+            rec.p = r.point_at_parameter(rec.t);
+            rec.normal = unit_vector(world_to_object.transposed_vector(rec.normal));
+            if (mat_id >= 0)
+                rec.mat_id = mat_id;
+            return true;
+        }
+
+        virtual aabb bounding_box() const {
+            affine_transform object_to_world = world_to_object.inverse();
+            aabb box = object->bounding_box();
+            aabb world;
+            for (int corner = 0; corner < 8; corner++) {
+                vec3 p(corner & 1 ? box.x.max : box.x.min,
+                       corner & 2 ? box.y.max : box.y.min,
+                       corner & 4 ? box.z.max : box.z.min);
+                vec3 q = object_to_world.point(p);
+                world = aabb(world, aabb(q, q));
+            }
+            // Inverting back loses a few bits, so grow the box to cover them.
+            const real slack = 64 * std::numeric_limits<real>::epsilon();
+            world.x = world.x.expand(slack * (std::fabs(world.x.min) + std::fabs(world.x.max)));
+            world.y = world.y.expand(slack * (std::fabs(world.y.min) + std::fabs(world.y.max)));
+            world.z = world.z.expand(slack * (std::fabs(world.z.min) + std::fabs(world.z.max)));
+            return world;
+        }
+
+        const hitable* object;
+        affine_transform world_to_object;
+        int mat_id;
+        real scale;
+};
+
+#endif
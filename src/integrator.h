@@ -0,0 +1,133 @@
+#ifndef INTEGRATORH
+#define INTEGRATORH
+
+#include "float.h"
+#include "hitable.h"
+#include "materials.h"
+#include "path_stats.h"
+#include "random.h"
+
+// Paths are cut off after this many bounces.
+const int max_depth = 50;
+static_assert(max_depth <= path_stats_max_depth, "path_stats histogram is too short");
+
+// Russian roulette starts after this many bounces.
+const int roulette_min_depth = 3;
+
+// Decides whether a path carries on past a bounce. From roulette_min_depth
+// on, it survives with probability p equal to its largest throughput
+// component (capped so bright paths still terminate eventually), and a
+// survivor's throughput is divided by p so the estimate stays unbiased.
+// u is a uniform random number in [0, 1).
+inline bool survive_roulette(vec3& throughput, double u) {
+    float p = throughput.x();
+    if (throughput.y() > p) p = throughput.y();
+    if (throughput.z() > p) p = throughput.z();
+    if (p > 0.95f) p = 0.95f;
+    if (u >= p)
+        return false;
+    throughput /= p;
+    return true;
+}
+
+// After a diffuse bounce a path's cone spreads at least this wide, in
+// radians. The scattered ray stands for a whole hemisphere, so what it
+// hits is averaged over many paths anyway; a wide cone keeps those lookups
+// on coarse texture levels that stay in cache.
+const real diffuse_cone_spread = 0.1;
+
+// A ray's footprint tracked as a cone, standing in for full ray
+// differentials, which would need every hitable's partial derivatives:
+// width is its width at the ray's origin and spread the angle it opens
+// at. Mirrors and glass pass the cone on unchanged, which ignores their
+// curvature; diffuse bounces widen it to diffuse_cone_spread.
+struct ray_cone {
+    real width = 0;
+    real spread = 0;
+
+    // Carries the cone along r to rec and leaves its width there in
+    // rec.footprint.
+    void reach(const ray& r, hit_record& rec) {
+        width += spread * rec.t * r.direction().length();
+        rec.footprint = width;
+    }
+
+    void bounce(material_type type) {
+        if (type == MAT_LAMBERTIAN && spread < diffuse_cone_spread)
+            spread = diffuse_cone_spread;
+    }
+};
+
+inline vec3 sky(const ray& r) {
+    vec3 unit_direction = unit_vector(r.direction());
+    real t = 0.5*(unit_direction.y() + 1.0);
+    return (1.0-t)*vec3(1.0, 1.0, 1.0) + t*vec3(0.5, 0.7, 1.0);
+}
+
+// The original recursive integrator, kept as the reference the iterative
+// and wavefront versions are measured against.
+inline vec3 color_recursive(const ray& r, const hitable *world, const material_table& materials, int depth) {
+    hit_record rec;
+    if (world->hit(r, 0.001, MAXFLOAT, rec)) {
+        ray scattered;
+        vec3 attenuation;
+        if (depth < max_depth && scatter(materials[rec.mat_id], r, rec, attenuation, scattered)) {
+            return attenuation*color_recursive(scattered, world, materials, depth+1);
+        }
+        else {
+            return vec3(0,0,0);
+        }
+    }
+    else {
+        return sky(r);
+    }
+}
+
+// Continues a path whose ray r has already hit rec, looping over bounces
+// and carrying the product of the attenuations so far as throughput. cone
+// is r's footprint, for texture filtering. Ends are counted in
+// thread_path_stats().
+inline vec3 color_from_hit(ray r, hit_record rec, const hitable *world, const material_table& materials,
+                           int depth = 0, bool roulette = true, ray_cone cone = ray_cone()) {
+    vec3 throughput(1, 1, 1);
+    while (true) {
+        if (depth >= max_depth) {
+            thread_path_stats().record(depth, PATH_MAX_DEPTH);
+            return vec3(0, 0, 0);
+        }
+        ray scattered;
+        vec3 attenuation;
+        const material& m = materials[rec.mat_id];
+        cone.reach(r, rec);
+        if (!scatter(m, r, rec, attenuation, scattered)) {
+            thread_path_stats().record(depth, PATH_ABSORBED);
+            return vec3(0, 0, 0);
+        }
+        cone.bounce(m.type);
+        throughput *= attenuation;
+        r = scattered;
+        depth++;
+        if (roulette && depth >= roulette_min_depth && !survive_roulette(throughput, random_double())) {
+            thread_path_stats().record(depth, PATH_ROULETTE);
+            return vec3(0, 0, 0);
+        }
+        if (!world->hit(r, 0.001, MAXFLOAT, rec)) {
+            thread_path_stats().record(depth, PATH_ESCAPED);
+            return throughput*sky(r);
+        }
+    }
+}
+
+// spread is the angle between neighbouring camera rays, from
+// camera::pixel_spread(), or 0 to read textures at full resolution.
+inline vec3 color(const ray& r, const hitable *world, const material_table& materials, bool roulette = true,
+                  real spread = 0) {
+    hit_record rec;
+    if (!world->hit(r, 0.001, MAXFLOAT, rec)) {
+        thread_path_stats().record(0, PATH_ESCAPED);
+        return sky(r);
+    }
+    return color_from_hit(r, rec, world, materials, 0, roulette, ray_cone{ 0, spread });
+}
+
+#endif
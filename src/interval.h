@@ -1,6 +1,8 @@
 #ifndef INTERVAL_H
 #define INTERVAL_H
 #include <cmath>
+#include <limits>
+#include "real.h"
 //==============================================================================================
 // To the extent possible under law, the author(s) have dedicated all copyright and related and
 // neighboring rights to this software to the public domain worldwide. This software is
@@ -10,59 +12,65 @@
 // along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
 //==============================================================================================
 
-class interval {
+template <typename T>
+class interval_t {
   public:
+    typedef T value_type;
 
-    double min, max;
+    T min, max;
 
-    interval() : min(std::numeric_limits<double>::infinity()), max(-std::numeric_limits<double>::infinity()) {} // Default interval is empty
+    interval_t() : min(std::numeric_limits<T>::infinity()), max(-std::numeric_limits<T>::infinity()) {} // Default interval is empty
 
-    interval(double min, double max) : min(min), max(max) {}
+    interval_t(T min, T max) : min(min), max(max) {}
 
-    interval(const interval& a, const interval& b) {
+    interval_t(const interval_t& a, const interval_t& b) {
         // Create the interval tightly enclosing the two input intervals.
         min = a.min <= b.min ? a.min : b.min;
         max = a.max >= b.max ? a.max : b.max;
     }
 
-    double size() const {
+    T size() const {
         return max - min;
     }
 
-    bool contains(double x) const {
+    bool contains(T x) const {
         return min <= x && x <= max;
     }
 
-    bool surrounds(double x) const {
+    bool surrounds(T x) const {
         return min < x && x < max;
     }
 
-    double clamp(double x) const {
+    T clamp(T x) const {
         if (x < min) return min;
         if (x > max) return max;
         return x;
     }
 
-    interval expand(double delta) const {
+    interval_t expand(T delta) const {
         auto padding = delta/2;
-        return interval(min - padding, max + padding);
+        return interval_t(min - padding, max + padding);
     }
 
-    static const interval empty, universe;
+    static const interval_t empty, universe;
 };
 
-#include <limits>
-
-const interval interval::empty    = interval(std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity());
-const interval interval::universe = interval(-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity());
+template <typename T>
+const interval_t<T> interval_t<T>::empty    = interval_t<T>(std::numeric_limits<T>::infinity(), -std::numeric_limits<T>::infinity());
+template <typename T>
+const interval_t<T> interval_t<T>::universe = interval_t<T>(-std::numeric_limits<T>::infinity(), std::numeric_limits<T>::infinity());
 
-interval operator+(const interval& ival, double displacement) {
-    return interval(ival.min + displacement, ival.max + displacement);
+template <typename T>
+interval_t<T> operator+(const interval_t<T>& ival, typename interval_t<T>::value_type displacement) {
+    return interval_t<T>(ival.min + displacement, ival.max + displacement);
 }
 
-interval operator+(double displacement, const interval& ival) {
+template <typename T>
+interval_t<T> operator+(typename interval_t<T>::value_type displacement, const interval_t<T>& ival) {
     return ival + displacement;
 }
 
+typedef interval_t<real> interval;
+
 
 #endif
\ No newline at end of file
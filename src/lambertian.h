@@ -1,16 +1,46 @@
+#ifndef LAMBERTIANH
+#define LAMBERTIANH
+
 #include "hitable.h"
 #include "material.h"
 #include "sphere.h"
+#include "texture.h"
+
+struct lambertian : public material {
+    lambertian(const vec3& a) {
+        type = MAT_LAMBERTIAN;
+        albedo = a;
+        ref_idx = 0;
+    }
 
-class lambertian : public material {
-public:
-    lambertian(const vec3& a) : albedo(a) {}
-    virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const {
-        vec3 target = rec.p + rec.normal + random_in_unit_sphere();
-        scattered = ray(rec.p, target - rec.p);
-        attenuation = albedo;
-        return true;
+    // Takes its colour from t at each hit. The scene owns t.
+    lambertian(const texture* t) {
+        type = MAT_LAMBERTIAN;
+        albedo = vec3(1, 1, 1);
+        ref_idx = 0;
+        tex = t;
     }
+};
+
+// The colour of t where r_in hit rec. The footprint the integrator left in
+// rec is widened by the angle the ray meets the surface at, then carried
+// into texture space with the surface's uv_length.
+inline vec3 texture_albedo(const texture& t, const ray& r_in, const hit_record& rec) {
+    real u, v, uv_length;
+    surface_uv(rec, u, v, uv_length);
+    real footprint = 0;
+    if (uv_length > 0 && rec.footprint > 0) {
+        real cosine = std::fabs(dot(rec.normal, r_in.direction())) / r_in.direction().length();
+        footprint = rec.footprint / (uv_length * std::fmax(cosine, real(0.05)));
+    }
+    return t.value(u, v, rec.p, footprint);
+}
+
+inline bool lambertian_scatter(const material& m, const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) {
+    vec3 target = rec.p + rec.normal + random_in_unit_sphere();
+    scattered = ray(rec.p, target - rec.p);
+    attenuation = m.tex ? texture_albedo(*m.tex, r_in, rec) : m.albedo;
+    return true;
+}
 
-    vec3 albedo;
-};
\ No newline at end of file
+#endif
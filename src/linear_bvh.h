@@ -0,0 +1,205 @@
+#ifndef LINEAR_BVHH
+#define LINEAR_BVHH
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "bvh.h"
+
+// A BVH node packed into 32 bytes so two fit in a cache line. Nodes are
+// stored in depth-first order: an interior node's first child is the next
+// node in the array and offset holds the index of the second child. For a
+// leaf, offset is the first of count primitives in the reordered primitive
+// array.
+struct alignas(32) linear_bvh_node {
+    float bmin[3];
+    float bmax[3];
+    int32_t offset;
+    uint16_t count;  // 0 for interior nodes
+    uint8_t axis;    // split axis of interior nodes
+    uint8_t pad;
+};
+
+static_assert(sizeof(linear_bvh_node) == 32, "linear_bvh_node must stay 32 bytes");
+
+// Traversal keeps an explicit stack of this many deferred nodes, so the
+// builder stops using SAH splits well before the tree gets this deep.
+const int linear_bvh_max_depth = 64;
+
+// Rounds the double precision bounds out to the nearest floats so the
+// stored box never shrinks.
+inline void set_node_bounds(linear_bvh_node& node, const aabb& box) {
+    for (int axis = 0; axis < 3; axis++) {
+        const interval& ax = box.axis_interval(axis);
+        float lo = float(ax.min), hi = float(ax.max);
+        if (lo > ax.min) lo = std::nextafter(lo, -INFINITY);
+        if (hi < ax.max) hi = std::nextafter(hi, INFINITY);
+        node.bmin[axis] = lo;
+        node.bmax[axis] = hi;
+    }
+}
+
+// Builds prims[start, end) into nodes and returns the index of its root.
+// Leaves are made when the SAH says a split would cost more than testing
+// every primitive, or when there are no more than max_leaf of them.
+inline int build_linear_bvh(std::vector<bvh_primitive>& prims, int start, int end,
+                            std::vector<linear_bvh_node>& nodes, int max_leaf, int depth = 0) {
+    // Expected cost of visiting a node, relative to one primitive test.
+    const double traversal_cost = 0.125;
+
+    int index = nodes.size();
+    nodes.push_back(linear_bvh_node());
+
+    aabb bounds;
+    for (int i = start; i < end; i++)
+        bounds = aabb(bounds, prims[i].box);
+    set_node_bounds(nodes[index], bounds);
+
+    int n = end - start;
+    int mid = -1;
+    int axis = 0;
+    if (n > 1) {
+        if (depth < linear_bvh_max_depth / 2) {
+            double cost;
+            mid = sah_partition(prims, start, end, cost, axis);
+            if (mid >= 0 && n <= max_leaf && traversal_cost + cost >= n)
+                mid = -1;
+        }
+        if (mid < 0 && (n > max_leaf || depth >= linear_bvh_max_depth / 2)) {
+            // Too many primitives for a leaf but SAH found nothing (or the tree
+            // is getting deep): fall back to a median split on the longest axis.
+            axis = bounds.longest_axis();
+            mid = start + n/2;
+            std::nth_element(prims.begin() + start, prims.begin() + mid, prims.begin() + end,
+                [axis](const bvh_primitive& a, const bvh_primitive& b) {
+                    return a.centroid[axis] < b.centroid[axis];
+                });
+        }
+    }
+
+    if (mid < 0) {
+        nodes[index].offset = start;
+        nodes[index].count = n;
+        return index;
+    }
+
+    build_linear_bvh(prims, start, mid, nodes, max_leaf, depth + 1);
+    int second = build_linear_bvh(prims, mid, end, nodes, max_leaf, depth + 1);
+    nodes[index].offset = second;
+    nodes[index].count = 0;
+    nodes[index].axis = axis;
+    return index;
+}
+
+// Each slab distance can be off by a few roundings, enough to miss a box
+// that a ray only grazes, such as a triangle's box seen along an edge.
+// Pushing the far distances out by this factor (Ize, "Robust BVH Ray
+// Traversal", JCGT 2013) keeps the slab tests conservative; hit_node and
+// hit_node_packet both apply it.
+const real slab_widen = 1 + 2 * (3 * (std::numeric_limits<real>::epsilon() / 2)
+                                 / (1 - 3 * (std::numeric_limits<real>::epsilon() / 2)));
+
+// Slab test against a packed node, with the ray's reciprocal direction
+// precomputed by the caller.
+inline bool hit_node(const linear_bvh_node& node, const vec3& origin, const vec3& inv_dir,
+                     real t_min, real t_max) {
+    for (int axis = 0; axis < 3; axis++) {
+        real t0 = (node.bmin[axis] - origin[axis]) * inv_dir[axis];
+        real t1 = (node.bmax[axis] - origin[axis]) * inv_dir[axis];
+        if (inv_dir[axis] < 0) {
+            real tmp = t0; t0 = t1; t1 = tmp;
+        }
+        t1 *= slab_widen;
+        t_min = t0 > t_min ? t0 : t_min;
+        t_max = t1 < t_max ? t1 : t_max;
+        if (t_max < t_min)
+            return false;
+    }
+    return true;
+}
+
+// Walks the nodes along r nearest child first, calling
+// leaf(first, count, tmax) for every leaf whose box the ray enters before
+// tmax. leaf tests primitives [first, first + count), lowers tmax to the
+// closest hit it finds and returns whether it found one, so boxes past the
+// closest hit so far are skipped. Shared by every tree stored this way.
+template <typename Leaf>
+inline bool traverse_linear_bvh(const std::vector<linear_bvh_node>& nodes, const ray& r,
+                                real tmin, real tmax, Leaf leaf) {
+    if (nodes.empty())
+        return false;
+
+    vec3 origin = r.origin();
+    vec3 dir = r.direction();
+    vec3 inv_dir(real(1)/dir[0], real(1)/dir[1], real(1)/dir[2]);
+    bool dir_neg[3] = { dir[0] < 0, dir[1] < 0, dir[2] < 0 };
+
+    int stack[linear_bvh_max_depth];
+    int sp = 0;
+    int current = 0;
+    bool hit_anything = false;
+    while (true) {
+        const linear_bvh_node& node = nodes[current];
+        if (hit_node(node, origin, inv_dir, tmin, tmax)) {
+            if (node.count > 0) {
+                if (leaf(node.offset, int(node.count), tmax))
+                    hit_anything = true;
+                if (sp == 0) break;
+                current = stack[--sp];
+            } else if (dir_neg[node.axis]) {
+                // The second child lies on the near side of the split.
+                stack[sp++] = current + 1;
+                current = node.offset;
+            } else {
+                stack[sp++] = node.offset;
+                current = current + 1;
+            }
+        } else {
+            if (sp == 0) break;
+            current = stack[--sp];
+        }
+    }
+    return hit_anything;
+}
+
+// A BVH over hitables laid out as one flat array of linear_bvh_nodes. Only
+// the primitives are reached through virtual calls; node traversal is a
+// loop with a small fixed stack that visits the nearer child first.
+class linear_bvh : public hitable {
+    public:
+        linear_bvh(hitable **l, int n, int max_leaf = 4) {
+            std::vector<bvh_primitive> bprims = make_bvh_primitives(l, n);
+            nodes.reserve(2*n);
+            build_linear_bvh(bprims, 0, n, nodes, max_leaf);
+            prims.resize(n);
+            for (int i = 0; i < n; i++)
+                prims[i] = l[bprims[i].index];
+        }
+
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            return traverse_linear_bvh(nodes, r, tmin, tmax, [&](int first, int count, real& closest) {
+                bool hit_anything = false;
+                for (int i = first; i < first + count; i++) {
+                    if (prims[i]->hit(r, tmin, closest, rec)) {
+                        hit_anything = true;
+                        closest = rec.t;
+                    }
+                }
+                return hit_anything;
+            });
+        }
+
+        virtual aabb bounding_box() const {
+            if (nodes.empty())
+                return aabb();
+            const linear_bvh_node& root = nodes[0];
+            return aabb(vec3(root.bmin[0], root.bmin[1], root.bmin[2]),
+                        vec3(root.bmax[0], root.bmax[1], root.bmax[2]));
+        }
+
+        std::vector<linear_bvh_node> nodes;
+        std::vector<hitable*> prims;
+};
+
+#endif
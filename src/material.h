@@ -1,34 +1,61 @@
 #ifndef MATERIAL_H
 #define MATERIAL_H
 
+#include <vector>
 #include "hitable.h"
-#include "hitablelist.h"
 
-class material{
-    public:
-        virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const = 0;
+// The closed set of material kinds, used to group hits by material so
+// shading stays coherent.
+enum material_type { MAT_LAMBERTIAN, MAT_METAL, MAT_DIELECTRIC, MAT_TYPE_COUNT };
 
-        vec3 reflect(const vec3& v, const vec3& n) const {
-            return v - 2*dot(v,n)*n;
-        }
+class texture;
+
+// Every material is one of the kinds above, stored as a tag plus the union
+// of their parameters, so materials sit by value in one array and a hit
+// names its material by index. lambertian, metal and dielectric construct
+// the matching record; scatter() in materials.h dispatches on the tag.
+struct material {
+    material_type type;
+    vec3 albedo;    // lambertian, metal
+    float ref_idx;  // dielectric
+    const texture* tex = nullptr;  // lambertian; replaces albedo if set
+};
 
-        bool refract(const vec3& v, const vec3& n, float ni_over_nt, vec3& refracted) const {
-            vec3 uv = unit_vector(v);
-            float dt = dot(uv, n);
-            float discriminant = 1.0 - ni_over_nt*ni_over_nt*(1-dt*dt);
-            if (discriminant > 0) {
-                refracted = ni_over_nt*(uv - n*dt) - n*sqrt(discriminant);
-                return true;
-            } else {
-                return false;
-            }
+// All of a scene's materials. hit_record::mat_id indexes into it.
+class material_table {
+    public:
+        int add(const material& m) {
+            records.push_back(m);
+            return int(records.size()) - 1;
         }
 
-        float schlick(float cosine, float ref_idx) const {
-        float r0 = (1-ref_idx) / (1+ref_idx);
-        r0 = r0*r0;
-        return r0 + (1-r0)*pow((1-cosine),5);
-    }
+        const material& operator[](int id) const { return records[id]; }
+        int size() const { return records.size(); }
+
+    private:
+        std::vector<material> records;
 };
 
-#endif
\ No newline at end of file
+inline vec3 reflect(const vec3& v, const vec3& n) {
+    return v - 2*dot(v,n)*n;
+}
+
+inline bool refract(const vec3& v, const vec3& n, float ni_over_nt, vec3& refracted) {
+    vec3 uv = unit_vector(v);
+    float dt = dot(uv, n);
+    float discriminant = 1.0 - ni_over_nt*ni_over_nt*(1-dt*dt);
+    if (discriminant > 0) {
+        refracted = ni_over_nt*(uv - n*dt) - n*sqrt(discriminant);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+inline float schlick(float cosine, float ref_idx) {
+    float r0 = (1-ref_idx) / (1+ref_idx);
+    r0 = r0*r0;
+    return r0 + (1-r0)*pow((1-cosine),5);
+}
+
+#endif
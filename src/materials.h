@@ -0,0 +1,21 @@
+#ifndef MATERIALSH
+#define MATERIALSH
+
+#include "material.h"
+#include "lambertian.h"
+#include "metal.h"
+#include "dielectric.h"
+
+// Scatters r_in off the material m it hit. A switch on the tag rather than a
+// virtual call, so each case can be inlined and no vtable load stands
+// between the hit and the shading code.
+inline bool scatter(const material& m, const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) {
+    switch (m.type) {
+        case MAT_LAMBERTIAN: return lambertian_scatter(m, r_in, rec, attenuation, scattered);
+        case MAT_METAL:      return metal_scatter(m, r_in, rec, attenuation, scattered);
+        case MAT_DIELECTRIC: return dielectric_scatter(m, r_in, rec, attenuation, scattered);
+        default:             return false;
+    }
+}
+
+#endif
@@ -1,13 +1,21 @@
+#ifndef METALH
+#define METALH
+
 #include "material.h"
 
-class metal : public material {
-    public:
-        metal(const vec3& a) : albedo(a) {}
-        virtual bool scatter(const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) const {
-            vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
-            scattered = ray(rec.p, reflected);
-            attenuation = albedo;
-            return (dot(scattered.direction(), rec.normal) > 0);
-        }
-        vec3 albedo;
-};
\ No newline at end of file
+struct metal : public material {
+    metal(const vec3& a) {
+        type = MAT_METAL;
+        albedo = a;
+        ref_idx = 0;
+    }
+};
+
+inline bool metal_scatter(const material& m, const ray& r_in, const hit_record& rec, vec3& attenuation, ray& scattered) {
+    vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
+    scattered = ray(rec.p, reflected);
+    attenuation = m.albedo;
+    return (dot(scattered.direction(), rec.normal) > 0);
+}
+
+#endif
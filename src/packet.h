@@ -0,0 +1,104 @@
+#ifndef PACKETH
+#define PACKETH
+
+#include <algorithm>
+#include <cstdint>
+#include "linear_bvh.h"
+
+// N coherent rays traced through a linear_bvh together. Origins and
+// reciprocal directions are kept as separate arrays so the per-node box test
+// runs across the whole packet at once.
+template <int N>
+struct ray_packet {
+    static_assert(N <= 32, "active masks are 32 bits wide");
+
+    ray rays[N];
+    real ox[N], oy[N], oz[N];
+    real inv_dx[N], inv_dy[N], inv_dz[N];
+
+    void set(int k, const ray& r) {
+        rays[k] = r;
+        vec3 o = r.origin(), d = r.direction();
+        ox[k] = o[0]; oy[k] = o[1]; oz[k] = o[2];
+        inv_dx[k] = real(1) / d[0]; inv_dy[k] = real(1) / d[1]; inv_dz[k] = real(1) / d[2];
+    }
+};
+
+// Returns a bit for every ray in the packet whose [t_min, t_max[k]] range
+// crosses the node's box. All N lanes are tested without branches so the
+// loop vectorizes; the caller masks off inactive rays. Far distances are
+// widened by slab_widen as in hit_node, so packets find the same grazing
+// hits as single rays.
+template <int N>
+inline uint32_t hit_node_packet(const linear_bvh_node& node, const ray_packet<N>& p,
+                                real t_min, const real* t_max) {
+    uint32_t mask = 0;
+    for (int k = 0; k < N; k++) {
+        real tx0 = (node.bmin[0] - p.ox[k]) * p.inv_dx[k], tx1 = (node.bmax[0] - p.ox[k]) * p.inv_dx[k];
+        real ty0 = (node.bmin[1] - p.oy[k]) * p.inv_dy[k], ty1 = (node.bmax[1] - p.oy[k]) * p.inv_dy[k];
+        real tz0 = (node.bmin[2] - p.oz[k]) * p.inv_dz[k], tz1 = (node.bmax[2] - p.oz[k]) * p.inv_dz[k];
+        real lo = t_min, hi = t_max[k];
+        lo = std::max(lo, std::min(tx0, tx1)); hi = std::min(hi, std::max(tx0, tx1) * slab_widen);
+        lo = std::max(lo, std::min(ty0, ty1)); hi = std::min(hi, std::max(ty0, ty1) * slab_widen);
+        lo = std::max(lo, std::min(tz0, tz1)); hi = std::min(hi, std::max(tz0, tz1) * slab_widen);
+        mask |= uint32_t(lo <= hi) << k;
+    }
+    return mask;
+}
+
+// Traces the rays in active through the tree as one packet. A node is
+// entered when any active ray hits its box, and the near child is chosen from
+// the first active ray's direction. Leaves test only the rays that reached
+// them. Fills recs[k] for every ray that hits and returns those bits.
+template <int N>
+uint32_t hit_packet(const linear_bvh& bvh, const ray_packet<N>& p, uint32_t active,
+                    real t_min, real t_max, hit_record* recs) {
+    if (bvh.nodes.empty() || !active)
+        return 0;
+
+    real closest[N];
+    for (int k = 0; k < N; k++)
+        closest[k] = t_max;
+
+    int lead = __builtin_ctz(active);
+    vec3 lead_dir = p.rays[lead].direction();
+    bool dir_neg[3] = { lead_dir[0] < 0, lead_dir[1] < 0, lead_dir[2] < 0 };
+
+    int stack[linear_bvh_max_depth];
+    int sp = 0;
+    int current = 0;
+    uint32_t hits = 0;
+    while (true) {
+        const linear_bvh_node& node = bvh.nodes[current];
+        uint32_t mask = hit_node_packet(node, p, t_min, closest) & active;
+        if (mask) {
+            if (node.count > 0) {
+                for (int i = node.offset; i < node.offset + node.count; i++) {
+                    uint32_t m = mask;
+                    while (m) {
+                        int k = __builtin_ctz(m);
+                        m &= m - 1;
+                        if (bvh.prims[i]->hit(p.rays[k], t_min, closest[k], recs[k])) {
+                            hits |= uint32_t(1) << k;
+                            closest[k] = recs[k].t;
+                        }
+                    }
+                }
+                if (sp == 0) break;
+                current = stack[--sp];
+            } else if (dir_neg[node.axis]) {
+                stack[sp++] = current + 1;
+                current = node.offset;
+            } else {
+                stack[sp++] = node.offset;
+                current = current + 1;
+            }
+        } else {
+            if (sp == 0) break;
+            current = stack[--sp];
+        }
+    }
+    return hits;
+}
+
+#endif
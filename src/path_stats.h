@@ -0,0 +1,106 @@
+#ifndef PATH_STATSH
+#define PATH_STATSH
+
+#include <iostream>
+#include <mutex>
+
+// Longest path the histogram tracks; matches the integrator's max_depth.
+const int path_stats_max_depth = 50;
+
+enum path_end { PATH_ESCAPED, PATH_ABSORBED, PATH_MAX_DEPTH, PATH_ROULETTE, PATH_END_COUNT };
+
+// How many paths ended after each number of bounces, and why they ended.
+struct path_stats {
+    long depth_histogram[path_stats_max_depth + 1] = {};
+    long ends[PATH_END_COUNT] = {};
+
+    void record(int depth, path_end why) {
+        depth_histogram[depth]++;
+        ends[why]++;
+    }
+
+    void add(const path_stats& other) {
+        for (int d = 0; d <= path_stats_max_depth; d++)
+            depth_histogram[d] += other.depth_histogram[d];
+        for (int e = 0; e < PATH_END_COUNT; e++)
+            ends[e] += other.ends[e];
+    }
+
+    long paths() const {
+        long n = 0;
+        for (int e = 0; e < PATH_END_COUNT; e++)
+            n += ends[e];
+        return n;
+    }
+
+    long bounces() const {
+        long n = 0;
+        for (int d = 0; d <= path_stats_max_depth; d++)
+            n += d * depth_histogram[d];
+        return n;
+    }
+
+    void print(std::ostream& out) const {
+        long n = paths();
+        out << n << " paths, " << bounces() << " bounces ("
+            << (n ? double(bounces()) / n : 0) << " per path)\n";
+        out << "ended by: escaped " << ends[PATH_ESCAPED] << ", absorbed " << ends[PATH_ABSORBED]
+            << ", max depth " << ends[PATH_MAX_DEPTH] << ", roulette " << ends[PATH_ROULETTE] << "\n";
+        out << "bounces  paths\n";
+        for (int d = 0; d <= path_stats_max_depth; d++)
+            if (depth_histogram[d])
+                out << d << "  " << depth_histogram[d] << "\n";
+    }
+};
+
+// Counters are kept per thread so recording a path costs a plain increment.
+// A thread's counts are folded into the shared totals when it calls
+// flush_thread_path_stats(), as tile_renderer's workers do after every
+// job, and when it exits.
+inline std::mutex& path_stats_lock() {
+    static std::mutex lock;
+    return lock;
+}
+
+inline path_stats& flushed_path_stats() {
+    static path_stats stats;
+    return stats;
+}
+
+struct thread_path_stats_holder {
+    path_stats stats;
+
+    void flush() {
+        std::lock_guard<std::mutex> guard(path_stats_lock());
+        flushed_path_stats().add(stats);
+        stats = path_stats();
+    }
+
+    ~thread_path_stats_holder() { flush(); }
+};
+
+inline thread_path_stats_holder& thread_path_stats_slot() {
+    thread_local thread_path_stats_holder holder;
+    return holder;
+}
+
+inline path_stats& thread_path_stats() {
+    return thread_path_stats_slot().stats;
+}
+
+// Moves the calling thread's counts into the shared totals.
+inline void flush_thread_path_stats() {
+    thread_path_stats_slot().flush();
+}
+
+// Totals over every flush plus the calling thread's own counts. Threads
+// still counting and not yet flushed are left out, so call it between
+// render jobs rather than during one.
+inline path_stats collect_path_stats() {
+    std::lock_guard<std::mutex> guard(path_stats_lock());
+    path_stats total = flushed_path_stats();
+    total.add(thread_path_stats());
+    return total;
+}
+
+#endif
@@ -1,63 +1,345 @@
     #ifndef PERLIN_H
     #define PERLIN_H
 
-    #include "vec3.h"
+    #include <cmath>
+    #include <cstdint>
     #include "random.h"
+    #include "simd.h"
+    #include "vec3.h"
+
+    // Perlin's gradient noise (Perlin 2002). Each integer lattice point gets a
+    // pseudo-random gradient, and the noise at p blends the eight gradients
+    // around it, each dotted with the offset from its corner, with Hermite
+    // weights 3t^2 - 2t^3. It is zero at every lattice point and roughly
+    // within [-1, 1].
+    //
+    // The lattice is one permutation of 0..255, repeated so hashing three
+    // coordinates never has to wrap. The gradient comes from the low four
+    // bits of a corner's hash, one of the twelve cube edge directions, so
+    // there is no gradient table and the whole lattice is this one block.
+    struct alignas(64) perlin_table {
+        // Four more bytes than the hashes reach, for the AVX2 gathers, which
+        // load four bytes at a time.
+        uint8_t perm[512 + 4];
+    };
+
+    constexpr perlin_table make_perlin_table(uint64_t seed) {
+        perlin_table table = {};
+        for (int i = 0; i < 256; i++)
+            table.perm[i] = uint8_t(i);
+        for (int i = 255; i > 0; i--) {
+            int target = int(splitmix64(seed) % uint64_t(i + 1));
+            uint8_t tmp = table.perm[i];
+            table.perm[i] = table.perm[target];
+            table.perm[target] = tmp;
+        }
+        for (int i = 0; i < 256; i++)
+            table.perm[256 + i] = table.perm[i];
+        return table;
+    }
+
+    // Built by the compiler, so perlin objects made without a seed cost a copy.
+    inline constexpr perlin_table default_perlin_table = make_perlin_table(1);
+
+    inline float perlin_fade(float t) {
+        return t*t*(3 - 2*t);
+    }
+
+    inline float perlin_lerp(float t, float a, float b) {
+        return a + t*(b - a);
+    }
+
+    // The gradients the low four bits of a hash pick: the twelve cube edge
+    // directions, four of them twice. Perlin picks them with branches on
+    // the bits, which mispredict half the time; a scalar lookup doesn't.
+    constexpr float perlin_gradients[16][3] = {
+        { 1,  1, 0}, {-1,  1, 0}, { 1, -1, 0}, {-1, -1, 0},
+        { 1,  0, 1}, {-1,  0, 1}, { 1,  0, -1}, {-1,  0, -1},
+        { 0,  1, 1}, { 0, -1, 1}, { 0,  1, -1}, { 0, -1, -1},
+        { 1,  1, 0}, { 0, -1, 1}, {-1,  1, 0}, { 0, -1, -1}
+    };
+
+    inline float perlin_grad(int hash, float x, float y, float z) {
+        const float* g = perlin_gradients[hash & 15];
+        return g[0]*x + g[1]*y + g[2]*z;
+    }
+
+    inline float perlin_noise(const perlin_table& table, float x, float y, float z) {
+        float fx = std::floor(x), fy = std::floor(y), fz = std::floor(z);
+        int X = int(fx) & 255, Y = int(fy) & 255, Z = int(fz) & 255;
+        x -= fx;
+        y -= fy;
+        z -= fz;
+        float u = perlin_fade(x), v = perlin_fade(y), w = perlin_fade(z);
+
+        const uint8_t* p = table.perm;
+        int A = p[X] + Y, AA = p[A] + Z, AB = p[A + 1] + Z;
+        int B = p[X + 1] + Y, BA = p[B] + Z, BB = p[B + 1] + Z;
+        float near = perlin_lerp(v, perlin_lerp(u, perlin_grad(p[AA], x, y, z), perlin_grad(p[BA], x - 1, y, z)),
+                                    perlin_lerp(u, perlin_grad(p[AB], x, y - 1, z), perlin_grad(p[BB], x - 1, y - 1, z)));
+        float far = perlin_lerp(v, perlin_lerp(u, perlin_grad(p[AA + 1], x, y, z - 1), perlin_grad(p[BA + 1], x - 1, y, z - 1)),
+                                   perlin_lerp(u, perlin_grad(p[AB + 1], x, y - 1, z - 1), perlin_grad(p[BB + 1], x - 1, y - 1, z - 1)));
+        return perlin_lerp(w, near, far);
+    }
+
+    // A batch kernel evaluates the noise at 8 points. The SIMD ones select
+    // and negate a gradient's two terms with masks where perlin_grad
+    // multiplies by 0 and 1, which comes to the same sums, and otherwise do
+    // perlin_noise's float operations in the same order, so all the kernels
+    // agree with it.
+    typedef void (*perlin_batch_fn)(const perlin_table& table, const float* x, const float* y,
+                                    const float* z, float* out);
+
+    inline void perlin_noise8_scalar(const perlin_table& table, const float* x, const float* y,
+                                     const float* z, float* out) {
+        for (int k = 0; k < 8; k++)
+            out[k] = perlin_noise(table, x[k], y[k], z[k]);
+    }
+
+    #ifdef SIMD_X86
+    __attribute__((target("sse2")))
+    inline __m128 perlin_fade_sse(__m128 t) {
+        return _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3), _mm_mul_ps(_mm_set1_ps(2), t)));
+    }
+
+    __attribute__((target("sse2")))
+    inline __m128 perlin_lerp_sse(__m128 t, __m128 a, __m128 b) {
+        return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+    }
+
+    __attribute__((target("sse2")))
+    inline __m128 perlin_select_sse(__m128i mask, __m128 a, __m128 b) {
+        __m128 m = _mm_castsi128_ps(mask);
+        return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+    }
+
+    __attribute__((target("sse2")))
+    inline __m128 perlin_grad_sse(__m128i hash, __m128 x, __m128 y, __m128 z) {
+        __m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+        __m128 u = perlin_select_sse(_mm_cmplt_epi32(h, _mm_set1_epi32(8)), x, y);
+        __m128i uses_x = _mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)), _mm_cmpeq_epi32(h, _mm_set1_epi32(14)));
+        __m128 v = perlin_select_sse(_mm_cmplt_epi32(h, _mm_set1_epi32(4)), y, perlin_select_sse(uses_x, x, z));
+        // Bits 0 and 1 of the hash, moved up to the sign bit, negate u and v.
+        u = _mm_xor_ps(u, _mm_castsi128_ps(_mm_slli_epi32(h, 31)));
+        v = _mm_xor_ps(v, _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(h, 1), 31)));
+        return _mm_add_ps(u, v);
+    }
+
+    // floor() for |x| < 2^31 without SSE4.1: truncate, then step down where
+    // that rounded up.
+    __attribute__((target("sse2")))
+    inline __m128 perlin_floor_sse(__m128 x, __m128i& i) {
+        i = _mm_cvttps_epi32(x);
+        __m128 t = _mm_cvtepi32_ps(i);
+        __m128 above = _mm_cmpgt_ps(t, x);
+        i = _mm_add_epi32(i, _mm_castps_si128(above));
+        return _mm_sub_ps(t, _mm_and_ps(above, _mm_set1_ps(1)));
+    }
+
+    // SSE2 has no gather, so the hashes are looked up a lane at a time and
+    // only the arithmetic is vectorized, four points at a pass.
+    __attribute__((target("sse2")))
+    inline void perlin_noise8_sse(const perlin_table& table, const float* px, const float* py,
+                                  const float* pz, float* out) {
+        const uint8_t* p = table.perm;
+        for (int k = 0; k < 8; k += 4) {
+            __m128 x = _mm_loadu_ps(px + k), y = _mm_loadu_ps(py + k), z = _mm_loadu_ps(pz + k);
+            __m128i ix, iy, iz;
+            x = _mm_sub_ps(x, perlin_floor_sse(x, ix));
+            y = _mm_sub_ps(y, perlin_floor_sse(y, iy));
+            z = _mm_sub_ps(z, perlin_floor_sse(z, iz));
+            alignas(16) int X[4], Y[4], Z[4];
+            __m128i byte = _mm_set1_epi32(255);
+            _mm_store_si128((__m128i*)X, _mm_and_si128(ix, byte));
+            _mm_store_si128((__m128i*)Y, _mm_and_si128(iy, byte));
+            _mm_store_si128((__m128i*)Z, _mm_and_si128(iz, byte));
+            alignas(16) int hash[8][4];
+            for (int lane = 0; lane < 4; lane++) {
+                int A = p[X[lane]] + Y[lane], AA = p[A] + Z[lane], AB = p[A + 1] + Z[lane];
+                int B = p[X[lane] + 1] + Y[lane], BA = p[B] + Z[lane], BB = p[B + 1] + Z[lane];
+                hash[0][lane] = p[AA];
+                hash[1][lane] = p[BA];
+                hash[2][lane] = p[AB];
+                hash[3][lane] = p[BB];
+                hash[4][lane] = p[AA + 1];
+                hash[5][lane] = p[BA + 1];
+                hash[6][lane] = p[AB + 1];
+                hash[7][lane] = p[BB + 1];
+            }
+            __m128 one = _mm_set1_ps(1);
+            __m128 x1 = _mm_sub_ps(x, one), y1 = _mm_sub_ps(y, one), z1 = _mm_sub_ps(z, one);
+            __m128 u = perlin_fade_sse(x), v = perlin_fade_sse(y), w = perlin_fade_sse(z);
+            __m128i h[8];
+            for (int c = 0; c < 8; c++)
+                h[c] = _mm_load_si128((const __m128i*)hash[c]);
+            __m128 near = perlin_lerp_sse(v, perlin_lerp_sse(u, perlin_grad_sse(h[0], x, y, z), perlin_grad_sse(h[1], x1, y, z)),
+                                             perlin_lerp_sse(u, perlin_grad_sse(h[2], x, y1, z), perlin_grad_sse(h[3], x1, y1, z)));
+            __m128 far = perlin_lerp_sse(v, perlin_lerp_sse(u, perlin_grad_sse(h[4], x, y, z1), perlin_grad_sse(h[5], x1, y, z1)),
+                                            perlin_lerp_sse(u, perlin_grad_sse(h[6], x, y1, z1), perlin_grad_sse(h[7], x1, y1, z1)));
+            _mm_storeu_ps(out + k, perlin_lerp_sse(w, near, far));
+        }
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256 perlin_fade_avx2(__m256 t) {
+        return _mm256_mul_ps(_mm256_mul_ps(t, t), _mm256_sub_ps(_mm256_set1_ps(3), _mm256_mul_ps(_mm256_set1_ps(2), t)));
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256 perlin_lerp_avx2(__m256 t, __m256 a, __m256 b) {
+        return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256 perlin_grad_avx2(__m256i hash, __m256 x, __m256 y, __m256 z) {
+        __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+        __m256 u = _mm256_blendv_ps(y, x, _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h)));
+        __m256i uses_x = _mm256_or_si256(_mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+                                         _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14)));
+        __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, _mm256_castsi256_ps(uses_x)), y,
+                                    _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h)));
+        u = _mm256_xor_ps(u, _mm256_castsi256_ps(_mm256_slli_epi32(h, 31)));
+        v = _mm256_xor_ps(v, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(h, 1), 31)));
+        return _mm256_add_ps(u, v);
+    }
+
+    // perm[i] in each lane: a four byte gather at byte offsets, masked down
+    // to the first byte.
+    __attribute__((target("avx2")))
+    inline __m256i perlin_perm_avx2(const uint8_t* perm, __m256i i) {
+        return _mm256_and_si256(_mm256_i32gather_epi32((const int*)perm, i, 1), _mm256_set1_epi32(255));
+    }
+
+    // All 8 points at once, the hashes included, with gathers from the
+    // permutation.
+    __attribute__((target("avx2")))
+    inline void perlin_noise8_avx2(const perlin_table& table, const float* px, const float* py,
+                                   const float* pz, float* out) {
+        __m256 x = _mm256_loadu_ps(px), y = _mm256_loadu_ps(py), z = _mm256_loadu_ps(pz);
+        __m256 fx = _mm256_floor_ps(x), fy = _mm256_floor_ps(y), fz = _mm256_floor_ps(z);
+        __m256i byte = _mm256_set1_epi32(255), one_i = _mm256_set1_epi32(1);
+        __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), byte);
+        __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), byte);
+        __m256i Z = _mm256_and_si256(_mm256_cvttps_epi32(fz), byte);
+        x = _mm256_sub_ps(x, fx);
+        y = _mm256_sub_ps(y, fy);
+        z = _mm256_sub_ps(z, fz);
+
+        const uint8_t* perm = table.perm;
+        __m256i A = _mm256_add_epi32(perlin_perm_avx2(perm, X), Y);
+        __m256i AA = _mm256_add_epi32(perlin_perm_avx2(perm, A), Z);
+        __m256i AB = _mm256_add_epi32(perlin_perm_avx2(perm, _mm256_add_epi32(A, one_i)), Z);
+        __m256i B = _mm256_add_epi32(perlin_perm_avx2(perm, _mm256_add_epi32(X, one_i)), Y);
+        __m256i BA = _mm256_add_epi32(perlin_perm_avx2(perm, B), Z);
+        __m256i BB = _mm256_add_epi32(perlin_perm_avx2(perm, _mm256_add_epi32(B, one_i)), Z);
+
+        __m256i h[8] = {
+            perlin_perm_avx2(perm, AA), perlin_perm_avx2(perm, BA),
+            perlin_perm_avx2(perm, AB), perlin_perm_avx2(perm, BB),
+            perlin_perm_avx2(perm, _mm256_add_epi32(AA, one_i)), perlin_perm_avx2(perm, _mm256_add_epi32(BA, one_i)),
+            perlin_perm_avx2(perm, _mm256_add_epi32(AB, one_i)), perlin_perm_avx2(perm, _mm256_add_epi32(BB, one_i))
+        };
+        __m256 one = _mm256_set1_ps(1);
+        __m256 x1 = _mm256_sub_ps(x, one), y1 = _mm256_sub_ps(y, one), z1 = _mm256_sub_ps(z, one);
+        __m256 u = perlin_fade_avx2(x), v = perlin_fade_avx2(y), w = perlin_fade_avx2(z);
+        __m256 near = perlin_lerp_avx2(v, perlin_lerp_avx2(u, perlin_grad_avx2(h[0], x, y, z), perlin_grad_avx2(h[1], x1, y, z)),
+                                          perlin_lerp_avx2(u, perlin_grad_avx2(h[2], x, y1, z), perlin_grad_avx2(h[3], x1, y1, z)));
+        __m256 far = perlin_lerp_avx2(v, perlin_lerp_avx2(u, perlin_grad_avx2(h[4], x, y, z1), perlin_grad_avx2(h[5], x1, y, z1)),
+                                         perlin_lerp_avx2(u, perlin_grad_avx2(h[6], x, y1, z1), perlin_grad_avx2(h[7], x1, y1, z1)));
+        _mm256_storeu_ps(out, perlin_lerp_avx2(w, near, far));
+    }
+    #endif
+
+    // Returns the kernel for the given level; AVX-512 machines use the AVX2
+    // one, since 8 points fill a 256 bit register.
+    inline perlin_batch_fn perlin_batch_kernel(simd_level level) {
+    #ifdef SIMD_X86
+        switch (level) {
+            case simd_avx512:
+            case simd_avx2:   return perlin_noise8_avx2;
+            case simd_sse:    return perlin_noise8_sse;
+            default:          break;
+        }
+    #endif
+        return perlin_noise8_scalar;
+    }
 
     class perlin {
       public:
-        perlin() {
-            randfloat = new double[point_count];
-            for (int i = 0; i < point_count; i++) {
-                randfloat[i] = random_double();
-            }
+        constexpr perlin() : table(default_perlin_table) {}
+        explicit constexpr perlin(uint64_t seed) : table(make_perlin_table(seed)) {}
 
-            perm_x = perlin_generate_perm();
-            perm_y = perlin_generate_perm();
-            perm_z = perlin_generate_perm();
+        real noise(const vec3& p) const {
+            return perlin_noise(table, float(p.x()), float(p.y()), float(p.z()));
         }
 
-        ~perlin() {
-            delete[] randfloat;
-            delete[] perm_x;
-            delete[] perm_y;
-            delete[] perm_z;
+        // Noise at 8 points given as separate coordinate arrays.
+        void noise8(const float* x, const float* y, const float* z, float* out) const {
+            batch(table, x, y, z, out);
         }
 
-        double noise(const vec3& p) const {
-            auto i = int(4*p.x()) & 255;
-            auto j = int(4*p.y()) & 255;
-            auto k = int(4*p.z()) & 255;
+        // Fractal sums of octaves, each at lacunarity times the frequency and
+        // gain times the weight of the one before. fbm adds the noise itself;
+        // turbulence adds its absolute value, which creases where the noise
+        // crosses zero.
+        real fbm(const vec3& p, int octaves = 7, real lacunarity = 2, real gain = 0.5) const {
+            return sum_octaves(p, octaves, lacunarity, gain, false);
+        }
 
-            return randfloat[perm_x[i] ^ perm_y[j] ^ perm_z[k]];
+        real turbulence(const vec3& p, int octaves = 7, real lacunarity = 2, real gain = 0.5) const {
+            return sum_octaves(p, octaves, lacunarity, gain, true);
         }
 
-      private:
-        static const int point_count = 256;
-        double* randfloat;
-        int* perm_x;
-        int* perm_y;
-        int* perm_z;
+        void fbm8(const float* x, const float* y, const float* z, float* out,
+                  int octaves = 7, float lacunarity = 2, float gain = 0.5f) const {
+            sum_octaves8(x, y, z, out, octaves, lacunarity, gain, false);
+        }
 
-        static int* perlin_generate_perm() {
-            auto p = new int[point_count];
+        void turbulence8(const float* x, const float* y, const float* z, float* out,
+                         int octaves = 7, float lacunarity = 2, float gain = 0.5f) const {
+            sum_octaves8(x, y, z, out, octaves, lacunarity, gain, true);
+        }
 
-            for (int i = 0; i < point_count; i++)
-                p[i] = i;
+        // The batch kernel noise8 uses, picked once from the CPU's features.
+        // Benchmarks may switch it.
+        inline static perlin_batch_fn batch = perlin_batch_kernel(cpu_simd_level());
 
-            permute(p, point_count);
+      private:
+        perlin_table table;
 
-            return p;
+        real sum_octaves(const vec3& p, int octaves, real lacunarity, real gain, bool absolute) const {
+            real sum = 0, weight = 1;
+            vec3 q = p;
+            for (int i = 0; i < octaves; i++) {
+                real n = noise(q);
+                sum += weight * (absolute ? std::fabs(n) : n);
+                weight *= gain;
+                q = lacunarity * q;
+            }
+            return sum;
         }
 
-        static void permute(int* p, int n) {
-            for (int i = n-1; i > 0; i--) {
-                int target = int(0 + (i-0)*random_double());
-                int tmp = p[i];
-                p[i] = p[target];
-                p[target] = tmp;
+        void sum_octaves8(const float* x, const float* y, const float* z, float* out,
+                          int octaves, float lacunarity, float gain, bool absolute) const {
+            alignas(32) float qx[8], qy[8], qz[8], n[8];
+            for (int k = 0; k < 8; k++) {
+                qx[k] = x[k];
+                qy[k] = y[k];
+                qz[k] = z[k];
+                out[k] = 0;
+            }
+            float weight = 1;
+            for (int i = 0; i < octaves; i++) {
+                batch(table, qx, qy, qz, n);
+                for (int k = 0; k < 8; k++) {
+                    out[k] += weight * (absolute ? std::fabs(n[k]) : n[k]);
+                    qx[k] *= lacunarity;
+                    qy[k] *= lacunarity;
+                    qz[k] *= lacunarity;
+                }
+                weight *= gain;
             }
         }
     };
 
-    #endif
\ No newline at end of file
+    #endif
@@ -0,0 +1,642 @@
+#ifndef PNGH
+#define PNGH
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// A small self-contained PNG encoder: per-row filter selection, then zlib
+// deflate with LZ77 matching and the fixed Huffman code. That gets most of
+// the gain of a full zlib on rendered images without any dependency. The
+// decoder at the end reads any non-interlaced PNG back, for textures.
+
+inline uint32_t png_crc32(const uint8_t* data, size_t n, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> t;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline uint32_t png_adler32(const uint8_t* data, size_t n) {
+    uint32_t a = 1, b = 0;
+    while (n > 0) {
+        size_t chunk = n < 5552 ? n : 5552;
+        n -= chunk;
+        while (chunk--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+// Writes bits least significant first, as deflate wants.
+struct deflate_bit_writer {
+    std::vector<uint8_t>& out;
+    uint32_t bits = 0;
+    int count = 0;
+
+    deflate_bit_writer(std::vector<uint8_t>& out) : out(out) {}
+
+    void put(uint32_t value, int n) {
+        bits |= value << count;
+        count += n;
+        while (count >= 8) {
+            out.push_back(bits & 0xff);
+            bits >>= 8;
+            count -= 8;
+        }
+    }
+
+    // Huffman codes are defined most significant bit first.
+    void put_code(uint32_t code, int n) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < n; i++)
+            reversed |= ((code >> i) & 1) << (n - 1 - i);
+        put(reversed, n);
+    }
+
+    void flush() {
+        if (count > 0)
+            out.push_back(bits & 0xff);
+        bits = 0;
+        count = 0;
+    }
+};
+
+inline void deflate_fixed_literal(deflate_bit_writer& w, int symbol) {
+    if (symbol < 144)      w.put_code(0x30 + symbol, 8);
+    else if (symbol < 256) w.put_code(0x190 + symbol - 144, 9);
+    else if (symbol < 280) w.put_code(symbol - 256, 7);
+    else                   w.put_code(0xc0 + symbol - 280, 8);
+}
+
+inline void deflate_fixed_match(deflate_bit_writer& w, int length, int distance) {
+    static const int length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                         35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const int length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                          3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const int dist_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                       257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                       8193, 12289, 16385, 24577 };
+    static const int dist_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    int lc = 28;
+    while (length_base[lc] > length) lc--;
+    deflate_fixed_literal(w, 257 + lc);
+    w.put(length - length_base[lc], length_extra[lc]);
+
+    int dc = 29;
+    while (dist_base[dc] > distance) dc--;
+    w.put_code(dc, 5);
+    w.put(distance - dist_base[dc], dist_extra[dc]);
+}
+
+// zlib stream of data using one fixed-Huffman block and hash chained LZ77
+// over a 32K window, or stored blocks if that would be smaller.
+inline std::vector<uint8_t> zlib_compress(const std::vector<uint8_t>& data) {
+    const int window = 32768;
+    const int hash_bits = 15;
+    const int max_chain = 8;
+    const int min_match = 3, max_match = 258;
+
+    std::vector<uint8_t> out;
+    out.reserve(data.size() / 2 + 64);
+    out.push_back(0x78);
+    out.push_back(0x9c);
+    uint32_t adler = png_adler32(data.data(), data.size());
+    auto put_adler = [&]() {
+        out.push_back(adler >> 24);
+        out.push_back(adler >> 16);
+        out.push_back(adler >> 8);
+        out.push_back(adler);
+    };
+
+    deflate_bit_writer w(out);
+    w.put(1, 1); // final block
+    w.put(1, 2); // fixed Huffman
+
+    std::vector<int> head(1 << hash_bits, -1);
+    std::vector<int> prev(window, -1);
+    auto hash_at = [&](size_t i) {
+        uint32_t h = (data[i] << 16) | (data[i+1] << 8) | data[i+2];
+        return (h * 2654435761u) >> (32 - hash_bits);
+    };
+    auto insert = [&](size_t i) {
+        if (i + min_match > data.size())
+            return;
+        uint32_t h = hash_at(i);
+        prev[i % window] = head[h];
+        head[h] = int(i);
+    };
+
+    size_t n = data.size();
+    size_t i = 0;
+    while (i < n) {
+        int best_len = 0, best_dist = 0;
+        if (i + min_match <= n) {
+            int candidate = head[hash_at(i)];
+            int limit = int(n - i) < max_match ? int(n - i) : max_match;
+            for (int chain = 0; chain < max_chain && candidate >= 0; chain++) {
+                int dist = int(i) - candidate;
+                if (dist > window - 1)
+                    break;
+                if (data[candidate + best_len] == data[i + best_len]) {
+                    int len = 0;
+                    while (len < limit && data[candidate + len] == data[i + len])
+                        len++;
+                    if (len > best_len) {
+                        best_len = len;
+                        best_dist = dist;
+                        if (len == limit)
+                            break;
+                    }
+                }
+                int next = prev[candidate % window];
+                if (next >= candidate)
+                    break;
+                candidate = next;
+            }
+        }
+
+        if (best_len >= min_match) {
+            deflate_fixed_match(w, best_len, best_dist);
+            for (int k = 0; k < best_len; k++)
+                insert(i + k);
+            i += best_len;
+        } else {
+            deflate_fixed_literal(w, data[i]);
+            insert(i);
+            i++;
+        }
+    }
+    deflate_fixed_literal(w, 256); // end of block
+    w.flush();
+
+    // Noise (the low bytes of 16 bit samples, say) doesn't compress, and the
+    // fixed code spends 9 bits on half the literals. Fall back to stored
+    // blocks when those come out smaller.
+    size_t stored_size = 2 + n + 5 * (n / 65535 + 1);
+    if (out.size() > stored_size) {
+        out.resize(2);
+        size_t pos = 0;
+        do {
+            size_t len = n - pos < 65535 ? n - pos : 65535;
+            out.push_back(pos + len == n ? 1 : 0); // final flag, stored type
+            out.push_back(len);
+            out.push_back(len >> 8);
+            out.push_back(~len);
+            out.push_back(~len >> 8);
+            out.insert(out.end(), data.begin() + pos, data.begin() + pos + len);
+            pos += len;
+        } while (pos < n);
+    }
+    put_adler();
+    return out;
+}
+
+inline uint8_t png_paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = p > a ? p - a : a - p;
+    int pb = p > b ? p - b : b - p;
+    int pc = p > c ? p - c : c - p;
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+// Encodes rows of RGB samples, top row first, 8 or 16 bits per channel (16
+// bit samples are big endian, as PNG stores them). Each row gets whichever
+// of the None, Sub, Up and Paeth filters leaves the smallest sum of
+// absolute residuals.
+inline std::vector<uint8_t> encode_png(const uint8_t* rgb, int width, int height, int bit_depth) {
+    int bpp = 3 * bit_depth / 8;
+    size_t stride = size_t(width) * bpp;
+
+    std::vector<uint8_t> filtered;
+    filtered.reserve((stride + 1) * height);
+    std::vector<uint8_t> zero_row(stride, 0), candidate(stride), best(stride);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = rgb + y * stride;
+        const uint8_t* up = y > 0 ? row - stride : zero_row.data();
+        long best_score = -1;
+        int best_filter = 0;
+        for (int filter : { 0, 1, 2, 4 }) {
+            long score = 0;
+            for (size_t x = 0; x < stride; x++) {
+                int left = x >= size_t(bpp) ? row[x - bpp] : 0;
+                int up_left = x >= size_t(bpp) ? up[x - bpp] : 0;
+                uint8_t predictor = 0;
+                if (filter == 1) predictor = left;
+                else if (filter == 2) predictor = up[x];
+                else if (filter == 4) predictor = png_paeth(left, up[x], up_left);
+                candidate[x] = uint8_t(row[x] - predictor);
+                score += int8_t(candidate[x]) < 0 ? -int8_t(candidate[x]) : int8_t(candidate[x]);
+            }
+            if (best_score < 0 || score < best_score) {
+                best_score = score;
+                best_filter = filter;
+                best.swap(candidate);
+            }
+        }
+        filtered.push_back(best_filter);
+        filtered.insert(filtered.end(), best.begin(), best.end());
+    }
+
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    auto put32 = [](std::vector<uint8_t>& v, uint32_t x) {
+        v.push_back(x >> 24); v.push_back(x >> 16); v.push_back(x >> 8); v.push_back(x);
+    };
+    auto chunk = [&](const char* type, const std::vector<uint8_t>& payload) {
+        put32(png, payload.size());
+        size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), payload.begin(), payload.end());
+        put32(png, png_crc32(png.data() + start, png.size() - start));
+    };
+
+    std::vector<uint8_t> header;
+    put32(header, width);
+    put32(header, height);
+    header.push_back(bit_depth);
+    header.push_back(2); // truecolour RGB
+    header.push_back(0); // deflate
+    header.push_back(0); // adaptive filtering
+    header.push_back(0); // no interlace
+    chunk("IHDR", header);
+    chunk("IDAT", zlib_compress(filtered));
+    chunk("IEND", std::vector<uint8_t>());
+    return png;
+}
+
+// Reads bits least significant first, the other half of deflate_bit_writer.
+// Reading past the end yields zeros and sets overrun.
+struct inflate_bit_reader {
+    const uint8_t* p;
+    const uint8_t* end;
+    uint64_t bits = 0;
+    int count = 0;
+    bool overrun = false;
+
+    inflate_bit_reader(const uint8_t* p, const uint8_t* end) : p(p), end(end) {}
+
+    uint32_t get(int n) {
+        while (count < n) {
+            if (p == end)
+                overrun = true;
+            else
+                bits |= uint64_t(*p++) << count;
+            count += 8;
+        }
+        uint32_t value = uint32_t(bits & ((uint64_t(1) << n) - 1));
+        bits >>= n;
+        count -= n;
+        return value;
+    }
+
+    // Drops the bits left in the current byte, for stored blocks.
+    void align() {
+        bits >>= count % 8;
+        count -= count % 8;
+    }
+};
+
+// A canonical Huffman code as deflate defines it: how many codes there are
+// of each length, and the symbols in code order. Decoding walks the
+// lengths one bit at a time.
+struct inflate_huffman {
+    uint16_t counts[16];
+    uint16_t symbols[320];
+
+    // False if the lengths describe more codes than fit.
+    bool build(const uint8_t* lengths, int n) {
+        memset(counts, 0, sizeof(counts));
+        for (int k = 0; k < n; k++)
+            counts[lengths[k]]++;
+        counts[0] = 0;
+        int left = 1;
+        for (int len = 1; len < 16; len++) {
+            left = 2*left - counts[len];
+            if (left < 0)
+                return false;
+        }
+        uint16_t offsets[16];
+        offsets[1] = 0;
+        for (int len = 1; len < 15; len++)
+            offsets[len + 1] = offsets[len] + counts[len];
+        for (int k = 0; k < n; k++)
+            if (lengths[k])
+                symbols[offsets[lengths[k]]++] = k;
+        return true;
+    }
+
+    int decode(inflate_bit_reader& in) const {
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len < 16; len++) {
+            code |= in.get(1);
+            int count = counts[len];
+            if (code - first < count)
+                return symbols[index + code - first];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+};
+
+// Appends the data of a zlib stream to out, failing if there are more than
+// limit bytes of it. On failure returns false with the reason in error.
+inline bool zlib_decompress(const uint8_t* data, size_t n, size_t limit, std::vector<uint8_t>& out,
+                            std::string& error) {
+    static const uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                              35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                              3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const uint16_t dist_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                            8193, 12289, 16385, 24577 };
+    static const uint8_t dist_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    if (n < 6 || (data[0] & 0x0f) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20)) {
+        error = "not a zlib stream";
+        return false;
+    }
+    size_t start = out.size();
+    inflate_bit_reader in(data + 2, data + n);
+    inflate_huffman lengths, distances;
+    bool last = false;
+    while (!last) {
+        last = in.get(1);
+        int type = in.get(2);
+        if (type == 0) {
+            in.align();
+            uint32_t len = in.get(16), nlen = in.get(16);
+            if (len != (~nlen & 0xffff) || in.overrun) {
+                error = "corrupt stored block";
+                return false;
+            }
+            for (uint32_t k = 0; k < len; k++)
+                out.push_back(in.get(8));
+        } else if (type == 1 || type == 2) {
+            uint8_t code_lengths[320];
+            int nlen = 288, ndist = 30;
+            if (type == 1) {
+                for (int k = 0; k < 288; k++)
+                    code_lengths[k] = k < 144 ? 8 : k < 256 ? 9 : k < 280 ? 7 : 8;
+                for (int k = 0; k < 30; k++)
+                    code_lengths[288 + k] = 5;
+            } else {
+                static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+                nlen = in.get(5) + 257;
+                ndist = in.get(5) + 1;
+                int ncode = in.get(4) + 4;
+                uint8_t header_lengths[19] = {};
+                for (int k = 0; k < ncode; k++)
+                    header_lengths[order[k]] = in.get(3);
+                inflate_huffman header;
+                if (nlen > 286 || ndist > 30 || !header.build(header_lengths, 19)) {
+                    error = "corrupt block header";
+                    return false;
+                }
+                for (int k = 0; k < nlen + ndist; ) {
+                    int symbol = header.decode(in);
+                    int repeat = 0, value = 0;
+                    if (symbol < 0) {
+                        error = "corrupt block header";
+                        return false;
+                    } else if (symbol < 16) {
+                        code_lengths[k++] = symbol;
+                        continue;
+                    } else if (symbol == 16) {
+                        if (k == 0) {
+                            error = "corrupt block header";
+                            return false;
+                        }
+                        value = code_lengths[k - 1];
+                        repeat = 3 + in.get(2);
+                    } else if (symbol == 17) {
+                        repeat = 3 + in.get(3);
+                    } else {
+                        repeat = 11 + in.get(7);
+                    }
+                    if (k + repeat > nlen + ndist) {
+                        error = "corrupt block header";
+                        return false;
+                    }
+                    while (repeat--)
+                        code_lengths[k++] = value;
+                }
+                memmove(code_lengths + 288, code_lengths + nlen, ndist);
+            }
+            if (!lengths.build(code_lengths, nlen) || !distances.build(code_lengths + 288, ndist)) {
+                error = "corrupt block header";
+                return false;
+            }
+            while (true) {
+                // Past the end the reader returns zeros, which would decode
+                // forever.
+                int symbol = lengths.decode(in);
+                if (symbol < 0 || in.overrun || out.size() - start > limit) {
+                    error = "corrupt compressed data";
+                    return false;
+                }
+                if (symbol < 256) {
+                    out.push_back(symbol);
+                    continue;
+                }
+                if (symbol == 256)
+                    break;
+                symbol -= 257;
+                if (symbol >= 29) {
+                    error = "corrupt compressed data";
+                    return false;
+                }
+                size_t len = length_base[symbol] + in.get(length_extra[symbol]);
+                int dist_symbol = distances.decode(in);
+                if (dist_symbol < 0 || dist_symbol >= 30) {
+                    error = "corrupt compressed data";
+                    return false;
+                }
+                size_t dist = dist_base[dist_symbol] + in.get(dist_extra[dist_symbol]);
+                if (dist > out.size() - start) {
+                    error = "corrupt compressed data";
+                    return false;
+                }
+                size_t from = out.size() - dist;
+                for (size_t k = 0; k < len; k++)
+                    out.push_back(out[from + k]);
+            }
+        } else {
+            error = "corrupt block type";
+            return false;
+        }
+        if (in.overrun) {
+            error = "truncated compressed data";
+            return false;
+        }
+        if (out.size() - start > limit) {
+            error = "more compressed data than expected";
+            return false;
+        }
+    }
+    in.align();
+    uint32_t adler = 0;
+    for (int k = 0; k < 4; k++)
+        adler = (adler << 8) | in.get(8);
+    if (in.overrun || adler != png_adler32(out.data() + start, out.size() - start)) {
+        error = "zlib checksum mismatch";
+        return false;
+    }
+    return true;
+}
+
+// The most pixels decode_png() accepts, 768 MiB of RGB. Anything larger is
+// far past what a texture needs and more likely a corrupt header.
+const size_t png_max_pixels = size_t(1) << 28;
+
+// Decodes a PNG into 8 bit RGB samples, top row first, whatever its colour
+// type and depth: 16 bit samples keep their high byte, grey is copied to
+// all three channels, palettes are looked up and alpha is dropped. On
+// failure returns false with the reason in error.
+inline bool decode_png(const uint8_t* data, size_t n, std::vector<uint8_t>& rgb, int& width, int& height,
+                       std::string& error) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    if (n < 8 || memcmp(data, signature, 8) != 0) {
+        error = "not a PNG file";
+        return false;
+    }
+    auto get32 = [](const uint8_t* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    };
+    int depth = 0, colour = -1;
+    std::vector<uint8_t> palette, compressed;
+    bool ended = false;
+    for (size_t pos = 8; !ended; ) {
+        if (n - pos < 12 || get32(data + pos) > n - pos - 12) {
+            error = "truncated PNG";
+            return false;
+        }
+        uint32_t len = get32(data + pos);
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* payload = type + 4;
+        if (png_crc32(type, len + 4) != get32(payload + len)) {
+            error = "PNG chunk checksum mismatch";
+            return false;
+        }
+        if (memcmp(type, "IHDR", 4) == 0 && len == 13) {
+            width = int(get32(payload));
+            height = int(get32(payload + 4));
+            depth = payload[8];
+            colour = payload[9];
+            if (payload[12] != 0) {
+                error = "interlaced PNGs aren't supported";
+                return false;
+            }
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            palette.assign(payload, payload + len);
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), payload, payload + len);
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            ended = true;
+        }
+        pos += 12 + len;
+    }
+
+    int channels = colour == 0 ? 1 : colour == 2 ? 3 : colour == 3 ? 1 : colour == 4 ? 2 : colour == 6 ? 4 : 0;
+    bool depth_ok = depth == 8 || (depth == 16 && colour != 3) || ((depth == 1 || depth == 2 || depth == 4) && (colour == 0 || colour == 3));
+    if (channels == 0 || !depth_ok || width <= 0 || height <= 0 || width > (1 << 24) || height > (1 << 24)) {
+        error = "unsupported PNG format";
+        return false;
+    }
+    if (size_t(width) * height > png_max_pixels) {
+        error = "PNG is too large";
+        return false;
+    }
+    if (colour == 3 && palette.empty()) {
+        error = "PNG has no palette";
+        return false;
+    }
+
+    size_t stride = (size_t(width) * channels * depth + 7) / 8;
+    int bpp = channels * depth / 8 > 0 ? channels * depth / 8 : 1;  // filter unit in bytes
+    // Deflate expands at most 1032 to 1, so a header claiming more than the
+    // data can hold is refused before anything is allocated for it.
+    size_t raw_size = (stride + 1) * height;
+    if (raw_size / 1032 > compressed.size()) {
+        error = "PNG image data is short";
+        return false;
+    }
+    std::vector<uint8_t> raw;
+    if (!zlib_decompress(compressed.data(), compressed.size(), raw_size, raw, error))
+        return false;
+    if (raw.size() < raw_size) {
+        error = "PNG image data is short";
+        return false;
+    }
+
+    rgb.resize(size_t(width) * height * 3);
+    std::vector<uint8_t> previous(stride, 0);
+    for (int y = 0; y < height; y++) {
+        uint8_t filter = raw[y * (stride + 1)];
+        uint8_t* row = raw.data() + y * (stride + 1) + 1;
+        for (size_t x = 0; x < stride; x++) {
+            int left = x >= size_t(bpp) ? row[x - bpp] : 0;
+            int up = previous[x];
+            int up_left = x >= size_t(bpp) ? previous[x - bpp] : 0;
+            switch (filter) {
+                case 0: break;
+                case 1: row[x] += left; break;
+                case 2: row[x] += up; break;
+                case 3: row[x] += (left + up) / 2; break;
+                case 4: row[x] += png_paeth(left, up, up_left); break;
+                default:
+                    error = "bad PNG filter";
+                    return false;
+            }
+        }
+        memcpy(previous.data(), row, stride);
+
+        uint8_t* out = rgb.data() + size_t(y) * width * 3;
+        for (int x = 0; x < width; x++) {
+            // The first byte of each sample is the most significant one.
+            auto sample = [&](int c) -> int {
+                if (depth >= 8)
+                    return row[(size_t(x) * channels + c) * (depth / 8)];
+                size_t bit = size_t(x) * depth;
+                int v = (row[bit / 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1);
+                return colour == 3 ? v : v * 255 / ((1 << depth) - 1);
+            };
+            if (colour == 3) {
+                size_t entry = size_t(sample(0)) * 3;
+                if (entry + 3 > palette.size()) {
+                    error = "PNG palette index out of range";
+                    return false;
+                }
+                memcpy(out + x*3, palette.data() + entry, 3);
+            } else if (channels <= 2) {
+                out[x*3] = out[x*3 + 1] = out[x*3 + 2] = sample(0);
+            } else {
+                for (int c = 0; c < 3; c++)
+                    out[x*3 + c] = sample(c);
+            }
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef POLYNOMIALH
+#define POLYNOMIALH
+
+#include <cmath>
+
+// Real roots of polynomials in one variable, as ray tracing implicit
+// surfaces needs them: without allocating, and only inside an interval.
+// Coefficients run from the constant term up, c[0] + c[1]*t + ... +
+// c[n]*t^n, in double whatever real is, since substituting a ray into a
+// surface of degree four or more cancels away most of a float's bits.
+
+const int max_polynomial_degree = 8;
+
+inline double eval_polynomial(const double* c, int n, double t) {
+    double value = c[n];
+    for (int k = n - 1; k >= 0; k--)
+        value = value*t + c[k];
+    return value;
+}
+
+// out = a * b, degree na + nb.
+inline void multiply_polynomials(const double* a, int na, const double* b, int nb, double* out) {
+    for (int k = 0; k <= na + nb; k++)
+        out[k] = 0;
+    for (int i = 0; i <= na; i++)
+        for (int j = 0; j <= nb; j++)
+            out[i + j] += a[i]*b[j];
+}
+
+// The real roots of c[0] + c[1]*t + c[2]*t^2, in increasing order.
+inline int solve_quadratic(const double c[3], double roots[2]) {
+    if (c[2] == 0) {
+        if (c[1] == 0)
+            return 0;
+        roots[0] = -c[0] / c[1];
+        return 1;
+    }
+    double discriminant = c[1]*c[1] - 4*c[2]*c[0];
+    if (discriminant < 0)
+        return 0;
+    // The root nearer zero from c/q, which doesn't cancel.
+    double q = -0.5 * (c[1] + std::copysign(std::sqrt(discriminant), c[1]));
+    if (q == 0) {
+        roots[0] = 0;
+        return 1;
+    }
+    double t0 = q / c[2], t1 = c[0] / q;
+    roots[0] = std::fmin(t0, t1);
+    roots[1] = std::fmax(t0, t1);
+    return 2;
+}
+
+// One Newton step on each root. The closed forms lose digits to
+// cancellation; a step from that close in gets most of them back.
+inline void polish_roots(const double* c, int n, double* roots, int count) {
+    for (int k = 0; k < count; k++) {
+        double t = roots[k];
+        double p = c[n], dp = 0;
+        for (int i = n - 1; i >= 0; i--) {
+            dp = dp*t + p;
+            p = p*t + c[i];
+        }
+        if (dp != 0)
+            roots[k] = t - p/dp;
+    }
+}
+
+inline void sort_roots(double* roots, int count) {
+    for (int i = 1; i < count; i++)
+        for (int j = i; j > 0 && roots[j] < roots[j - 1]; j--) {
+            double tmp = roots[j]; roots[j] = roots[j - 1]; roots[j - 1] = tmp;
+        }
+}
+
+// The real roots of a cubic in increasing order, by Cardano's formula for
+// one real root and the trigonometric form for three.
+inline int solve_cubic(const double c[4], double roots[3]) {
+    if (c[3] == 0)
+        return solve_quadratic(c, roots);
+    // t = x - a/3 turns x^3 + a*x^2 + b*x + d into t^3 + p*t + q.
+    double a = c[2]/c[3], b = c[1]/c[3], d = c[0]/c[3];
+    double shift = a/3;
+    double p = b - a*shift;
+    double q = 2*shift*shift*shift - shift*b + d;
+    double h = q*q/4 + p*p*p/27;
+    int count;
+    if (h > 0) {
+        double s = std::sqrt(h);
+        double u = std::cbrt(-q/2 + (q > 0 ? -s : s));
+        roots[0] = (u != 0 ? u - p/(3*u) : 0) - shift;
+        count = 1;
+    } else if (p == 0) {
+        roots[0] = -shift;
+        count = 1;
+    } else {
+        double m = 2*std::sqrt(-p/3);
+        double phi = std::acos(std::fmax(-1.0, std::fmin(1.0, 3*q/(p*m)))) / 3;
+        for (int k = 0; k < 3; k++)
+            roots[k] = m*std::cos(phi - 2*M_PI*k/3) - shift;
+        count = 3;
+    }
+    polish_roots(c, 3, roots, count);
+    sort_roots(roots, count);
+    return count;
+}
+
+// The real roots of a quartic in increasing order, by Ferrari's method:
+// a root of the resolvent cubic splits the depressed quartic into two
+// quadratics.
+inline int solve_quartic(const double c[5], double roots[4]) {
+    if (c[4] == 0)
+        return solve_cubic(c, roots);
+    double a = c[3]/c[4], b = c[2]/c[4], d = c[1]/c[4], e = c[0]/c[4];
+    // x = t - a/4 gives t^4 + p*t^2 + q*t + r.
+    double shift = a/4;
+    double a2 = a*a;
+    double p = b - 3*a2/8;
+    double q = d - a*b/2 + a2*a/8;
+    double r = e - a*d/4 + a2*b/16 - 3*a2*a2/256;
+    int count = 0;
+    if (std::fabs(q) < 1e-14 * (std::fabs(p) + std::fabs(r) + 1)) {
+        // Biquadratic: a quadratic in t^2.
+        double qc[3] = { r, p, 1 }, s[2];
+        int n = solve_quadratic(qc, s);
+        for (int k = 0; k < n; k++) {
+            if (s[k] < 0)
+                continue;
+            double root = std::sqrt(s[k]);
+            roots[count++] = root - shift;
+            roots[count++] = -root - shift;
+        }
+    } else {
+        // (t^2 + m)^2 = (2m - p)t^2 - q*t + m^2 - r, where m makes the
+        // right side a square: 8m^3 - 4p*m^2 - 8r*m + 4p*r - q^2 = 0. The
+        // largest root keeps 2m - p > 0.
+        double cubic[4] = { 4*p*r - q*q, -8*r, -4*p, 8 }, ms[3];
+        int n = solve_cubic(cubic, ms);
+        double m = ms[n - 1];
+        double w2 = 2*m - p;
+        if (w2 <= 0)
+            return 0;
+        double w = std::sqrt(w2);
+        double s[2];
+        double left[3] = { m + q/(2*w), -w, 1 };
+        int k = solve_quadratic(left, s);
+        for (int i = 0; i < k; i++)
+            roots[count++] = s[i] - shift;
+        double right[3] = { m - q/(2*w), w, 1 };
+        k = solve_quadratic(right, s);
+        for (int i = 0; i < k; i++)
+            roots[count++] = s[i] - shift;
+    }
+    polish_roots(c, 4, roots, count);
+    sort_roots(roots, count);
+    return count;
+}
+
+// Narrows [lo, hi], where p(lo) and p(hi) differ in sign and p is monotonic,
+// to the root between them: Newton steps, with bisection whenever a step
+// would leave the bracket or isn't shrinking it fast enough.
+inline double bracketed_root(const double* c, int n, double lo, double hi, double plo) {
+    double t = 0.5*(lo + hi);
+    for (int iteration = 0; iteration < 64; iteration++) {
+        double p = c[n], dp = 0;
+        for (int i = n - 1; i >= 0; i--) {
+            dp = dp*t + p;
+            p = p*t + c[i];
+        }
+        if (p == 0)
+            return t;
+        if ((p < 0) == (plo < 0))
+            lo = t;
+        else
+            hi = t;
+        double next = dp != 0 ? t - p/dp : lo;
+        if (!(next > lo && next < hi) || std::fabs(next - t) > 0.5*(hi - lo))
+            next = 0.5*(lo + hi);
+        if (std::fabs(next - t) <= 1e-13 * std::fmax(1.0, std::fabs(t)))
+            return next;
+        t = next;
+    }
+    return t;
+}
+
+// The real roots of a polynomial of degree n <= max_polynomial_degree
+// inside (lo, hi), in increasing order, at most max_roots of them. Between
+// consecutive roots of the derivative the polynomial is monotonic, so each
+// such piece holds at most one root and a sign change brackets it; the
+// derivative's roots are found the same way, one degree down. Roots where
+// the polynomial only touches zero are missed, which for a ray means a
+// grazing hit.
+inline int polynomial_roots(const double* c, int n, double lo, double hi, double* roots, int max_roots) {
+    while (n > 0 && c[n] == 0)
+        n--;
+    if (n == 0 || max_roots <= 0)
+        return 0;
+    if (n == 1) {
+        double t = -c[0]/c[1];
+        if (t > lo && t < hi) {
+            roots[0] = t;
+            return 1;
+        }
+        return 0;
+    }
+
+    double derivative[max_polynomial_degree];
+    for (int k = 1; k <= n; k++)
+        derivative[k - 1] = k*c[k];
+    double ends[max_polynomial_degree + 1];
+    int pieces = polynomial_roots(derivative, n - 1, lo, hi, ends, n - 1);
+    ends[pieces] = hi;
+
+    int count = 0;
+    double a = lo, pa = eval_polynomial(c, n, lo);
+    for (int k = 0; k <= pieces && count < max_roots; k++) {
+        double b = ends[k], pb = eval_polynomial(c, n, b);
+        if (pb == 0) {
+            if (b < hi)
+                roots[count++] = b;
+        } else if ((pa < 0) != (pb < 0) && pa != 0) {
+            roots[count++] = bracketed_root(c, n, a, b, pa);
+        }
+        a = b;
+        pa = pb;
+    }
+    return count;
+}
+
+// The smallest root in (lo, hi), with solve_quadratic, solve_cubic or
+// solve_quartic for the degrees they cover and polynomial_roots above
+// that.
+inline bool first_root_closed_form(const double* c, int n, double lo, double hi, double& t) {
+    double roots[4];
+    int count;
+    switch (n) {
+        case 2:  count = solve_quadratic(c, roots); break;
+        case 3:  count = solve_cubic(c, roots); break;
+        case 4:  count = solve_quartic(c, roots); break;
+        default: return polynomial_roots(c, n, lo, hi, &t, 1) == 1;
+    }
+    for (int k = 0; k < count; k++)
+        if (roots[k] > lo && roots[k] < hi) {
+            t = roots[k];
+            return true;
+        }
+    return false;
+}
+
+// The smallest root in (lo, hi) by polynomial_roots alone.
+inline bool first_root_bracketed(const double* c, int n, double lo, double hi, double& t) {
+    return polynomial_roots(c, n, lo, hi, &t, 1) == 1;
+}
+
+#endif
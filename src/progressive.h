@@ -0,0 +1,135 @@
+#ifndef PROGRESSIVEH
+#define PROGRESSIVEH
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "image.h"
+#include "random.h"
+#include "tile_renderer.h"
+#include "vec3.h"
+
+// Checkpoint file layout: this header, then the accumulated sums as
+// nx*ny*3 reals in framebuffer order. Everything is in host byte order, and
+// the sums are kept at full precision so a resumed render matches an
+// uninterrupted one; a file from a build with a different real is refused.
+struct checkpoint_header {
+    char magic[4];     // "RTCK"
+    uint32_t version;
+    int32_t nx, ny;
+    uint64_t seed;
+    int32_t passes;    // samples taken by every pixel so far
+    uint32_t real_size;  // sizeof(real) of the build that wrote it
+};
+
+const uint32_t checkpoint_version = 2;
+
+// The seed of every pixel's stream in a given pass. Streams depend only on
+// (seed, pass, i, j), so the render seed and the pass count are all the RNG
+// state a checkpoint has to keep.
+inline uint64_t pass_seed(uint64_t seed, int pass) {
+    uint64_t x = seed + uint64_t(pass) * 0x9e3779b97f4a7c15ull;
+    return splitmix64(x);
+}
+
+// Renders the whole frame one sample per pixel at a time, summing into an
+// accumulation buffer, so a render can be stopped after any pass and
+// picked up again from a checkpoint. Resuming gives exactly the image an
+// uninterrupted run would have.
+class progressive_renderer {
+    public:
+        progressive_renderer(int nx, int ny, uint64_t seed)
+            : nx(nx), ny(ny), seed(seed), passes(0), sum(nx*ny, vec3(0, 0, 0)) {}
+
+        // Adds one sample to every pixel. sample(i, j) returns the radiance
+        // of a new sample of pixel (i, j), drawing from random_double().
+        template <typename Sampler>
+        void render_pass(Sampler sample, const tile_renderer& renderer) {
+            uint64_t s = pass_seed(seed, passes);
+            renderer.render_tiles([&](const tile& t) {
+                for (int j = t.y0; j < t.y1; j++) {
+                    for (int i = t.x0; i < t.x1; i++) {
+                        seed_random(pixel_seed(s, i, j));
+                        sum[j*nx + i] += sample(i, j);
+                    }
+                }
+            });
+            passes++;
+        }
+
+        // The current estimate: the mean of the passes so far.
+        void resolve(image& img) const {
+            img = image(nx, ny);
+            if (passes == 0)
+                return;
+            for (int p = 0; p < nx*ny; p++)
+                img.pixels[p] = sum[p] / float(passes);
+        }
+
+        // Writes the checkpoint to a temporary file and renames it over path,
+        // so a job killed mid-write leaves the previous checkpoint intact.
+        bool save_checkpoint(const std::string& path) const {
+            checkpoint_header h;
+            memcpy(h.magic, "RTCK", 4);
+            h.version = checkpoint_version;
+            h.nx = nx;
+            h.ny = ny;
+            h.seed = seed;
+            h.passes = passes;
+            h.real_size = sizeof(real);
+
+            std::vector<real> data(size_t(nx) * ny * 3);
+            for (size_t p = 0; p < sum.size(); p++)
+                for (int c = 0; c < 3; c++)
+                    data[p*3 + c] = sum[p][c];
+
+            std::string tmp = path + ".tmp";
+            FILE* f = fopen(tmp.c_str(), "wb");
+            if (!f)
+                return false;
+            bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+                   && fwrite(data.data(), sizeof(real), data.size(), f) == data.size();
+            ok = fclose(f) == 0 && ok;
+            if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+                remove(tmp.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        // Restores the state saved by save_checkpoint. Fails, leaving this
+        // renderer unchanged, if the file is missing, the wrong length, or
+        // was made for a different image size, seed or precision.
+        bool load_checkpoint(const std::string& path) {
+            FILE* f = fopen(path.c_str(), "rb");
+            if (!f)
+                return false;
+            checkpoint_header h;
+            std::vector<real> data(size_t(nx) * ny * 3);
+            bool ok = fread(&h, sizeof(h), 1, f) == 1
+                   && memcmp(h.magic, "RTCK", 4) == 0 && h.version == checkpoint_version
+                   && h.real_size == sizeof(real)
+                   && h.nx == nx && h.ny == ny && h.seed == seed && h.passes >= 0
+                   && fread(data.data(), sizeof(real), data.size(), f) == data.size()
+                   && fgetc(f) == EOF;
+            fclose(f);
+            if (!ok)
+                return false;
+
+            for (size_t p = 0; p < sum.size(); p++)
+                sum[p] = vec3(data[p*3], data[p*3 + 1], data[p*3 + 2]);
+            passes = h.passes;
+            return true;
+        }
+
+        int nx, ny;
+        uint64_t seed;
+        int passes;
+
+    private:
+        std::vector<vec3> sum;
+};
+
+#endif
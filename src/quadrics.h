@@ -0,0 +1,324 @@
+#ifndef QUADRICSH
+#define QUADRICSH
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "aligned.h"
+#include "hitable.h"
+#include "sphere_soa.h"
+
+// Cylinders, cones and disks. Each is given by a base point, a unit axis
+// and a radius; cylinders and cones also by a height along the axis:
+//
+//   cylinder  radius at every height in [0, height]
+//   cone      radius at the base, narrowing to a point at height
+//   disk      radius at the base only; the axis is its normal
+//
+// Cylinders and cones are open tubes unless capped, which closes the ends
+// with disks (the base only, for a cone). Normals face out of the solid,
+// and along the axis for a disk, whichever side the ray comes from, as
+// sphere normals do.
+enum quadric_type { QUADRIC_CYLINDER, QUADRIC_CONE, QUADRIC_DISK };
+
+struct quadric_shape {
+    quadric_type type;
+    vec3 base;
+    vec3 axis;
+    real radius;
+    real height;
+    bool capped;
+    int mat_id;
+};
+
+// A ray split into its components along a shape's axis, measured from the
+// base, and across it.
+struct axial_ray {
+    vec3 o_across, d_across;
+    real o_along, d_along;
+
+    axial_ray(const ray& r, const vec3& base, const vec3& axis) {
+        vec3 oc = r.origin() - base;
+        o_along = dot(oc, axis);
+        d_along = dot(r.direction(), axis);
+        o_across = oc - o_along*axis;
+        d_across = r.direction() - d_along*axis;
+    }
+};
+
+// Roots of a*t^2 + 2*b*t + c in increasing order. The smaller-magnitude
+// root comes from c/q rather than the textbook formula, so it stays
+// accurate when b*b dwarfs a*c and when a goes to zero, as it does for
+// rays parallel to a cone's side.
+inline bool quadric_roots(real a, real b, real c, real discriminant, real& t0, real& t1) {
+    if (discriminant < 0)
+        return false;
+    real q = -(b + std::copysign(std::sqrt(discriminant), b));
+    if (q == 0)
+        return false;
+    t0 = c / q;
+    t1 = a != 0 ? q / a : t0;
+    if (t0 > t1) {
+        real tmp = t0; t0 = t1; t1 = tmp;
+    }
+    return true;
+}
+
+// The plane across the axis at height y, within radius of it. Lowers tmax
+// to the hit.
+inline bool hit_axial_disk(const axial_ray& s, real y, real radius, real tmin, real& tmax) {
+    if (s.d_along == 0)
+        return false;
+    real t = (y - s.o_along) / s.d_along;
+    if (t <= tmin || t >= tmax)
+        return false;
+    vec3 across = s.o_across + t*s.d_across;
+    if (dot(across, across) > radius*radius)
+        return false;
+    tmax = t;
+    return true;
+}
+
+inline void set_quadric_record(const quadric_shape& q, const ray& r, real t, const vec3& normal, hit_record& rec) {
+    rec.t = t;
+    rec.p = r.point_at_parameter(t);
+    rec.normal = normal;
+    rec.mat_id = q.mat_id;
+    rec.mapping = UV_NONE;
+}
+
+inline bool hit_cylinder(const quadric_shape& q, const ray& r, real tmin, real tmax, hit_record& rec) {
+    axial_ray s(r, q.base, q.axis);
+    real a = dot(s.d_across, s.d_across);
+    real b = dot(s.o_across, s.d_across);
+    real c = dot(s.o_across, s.o_across) - q.radius*q.radius;
+    bool hit = false;
+    vec3 normal;
+    real t0, t1;
+    // The discriminant from the ray's closest approach to the axis, rather
+    // than b*b - a*c, which cancels badly when the cylinder is thin or far.
+    vec3 closest = s.o_across - (b/a)*s.d_across;
+    real discriminant = a*(q.radius*q.radius - dot(closest, closest));
+    if (a > 0 && quadric_roots(a, b, c, discriminant, t0, t1)) {
+        // The nearer root can be outside the height range while the
+        // farther one, on the inside wall, is within it.
+        for (real t : { t0, t1 }) {
+            real y = s.o_along + t*s.d_along;
+            if (t > tmin && t < tmax && y >= 0 && y <= q.height) {
+                tmax = t;
+                normal = (s.o_across + t*s.d_across) / q.radius;
+                hit = true;
+                break;
+            }
+        }
+    }
+    if (q.capped) {
+        if (hit_axial_disk(s, 0, q.radius, tmin, tmax)) {
+            normal = -q.axis;
+            hit = true;
+        }
+        if (hit_axial_disk(s, q.height, q.radius, tmin, tmax)) {
+            normal = q.axis;
+            hit = true;
+        }
+    }
+    if (hit)
+        set_quadric_record(q, r, tmax, normal, rec);
+    return hit;
+}
+
+inline bool hit_cone(const quadric_shape& q, const ray& r, real tmin, real tmax, hit_record& rec) {
+    // The side is where the distance across the axis is k times the
+    // distance w left to the apex. Both nappes solve that; the height
+    // range keeps the one the cone is made of.
+    axial_ray s(r, q.base, q.axis);
+    real k = q.radius / q.height;
+    real k2 = k*k;
+    real w0 = q.height - s.o_along;
+    // The terms cancel whenever the ray passes close to the side, and
+    // unlike the cylinder's there is no closest approach to rewrite them
+    // around, so they are summed in double.
+    double ox = s.o_across[0], oy = s.o_across[1], oz = s.o_across[2];
+    double dx = s.d_across[0], dy = s.d_across[1], dz = s.d_across[2];
+    double a = dx*dx + dy*dy + dz*dz - double(k2)*s.d_along*s.d_along;
+    double b = ox*dx + oy*dy + oz*dz + double(k2)*w0*s.d_along;
+    double c = ox*ox + oy*oy + oz*oz - double(k2)*w0*w0;
+    bool hit = false;
+    vec3 normal;
+    real t0, t1;
+    if (quadric_roots(a, b, c, b*b - a*c, t0, t1)) {
+        for (real t : { t0, t1 }) {
+            real y = s.o_along + t*s.d_along;
+            if (t > tmin && t < tmax && y >= 0 && y <= q.height) {
+                tmax = t;
+                // The gradient of |across|^2 - (k*w)^2, which vanishes
+                // only at the apex.
+                vec3 n = s.o_across + t*s.d_across + (k2*(q.height - y))*q.axis;
+                normal = dot(n, n) > 0 ? unit_vector(n) : q.axis;
+                hit = true;
+                break;
+            }
+        }
+    }
+    if (q.capped && hit_axial_disk(s, 0, q.radius, tmin, tmax)) {
+        normal = -q.axis;
+        hit = true;
+    }
+    if (hit)
+        set_quadric_record(q, r, tmax, normal, rec);
+    return hit;
+}
+
+inline bool hit_disk(const quadric_shape& q, const ray& r, real tmin, real tmax, hit_record& rec) {
+    axial_ray s(r, q.base, q.axis);
+    if (!hit_axial_disk(s, 0, q.radius, tmin, tmax))
+        return false;
+    set_quadric_record(q, r, tmax, q.axis, rec);
+    return true;
+}
+
+inline bool hit_quadric(const quadric_shape& q, const ray& r, real tmin, real tmax, hit_record& rec) {
+    switch (q.type) {
+        case QUADRIC_CYLINDER: return hit_cylinder(q, r, tmin, tmax, rec);
+        case QUADRIC_CONE:     return hit_cone(q, r, tmin, tmax, rec);
+        default:               return hit_disk(q, r, tmin, tmax, rec);
+    }
+}
+
+// The tight box. A circle of radius r across a unit axis reaches
+// r*sqrt(1 - axis[i]^2) either side of its centre along world axis i.
+inline aabb quadric_box(const quadric_shape& q) {
+    vec3 reach;
+    for (int i = 0; i < 3; i++)
+        reach[i] = q.radius * std::sqrt(std::fmax(real(0), 1 - q.axis[i]*q.axis[i]));
+    aabb box(q.base - reach, q.base + reach);
+    if (q.type == QUADRIC_DISK)
+        return box;
+    vec3 top = q.base + q.height*q.axis;
+    if (q.type == QUADRIC_CONE)
+        return aabb(box, aabb(top, top));
+    return aabb(box, aabb(top - reach, top + reach));
+}
+
+// A sphere around the whole shape, for sphere_soa's batch kernels.
+inline void quadric_bounds(const quadric_shape& q, vec3& center, real& radius) {
+    if (q.type == QUADRIC_DISK) {
+        center = q.base;
+        radius = q.radius;
+        return;
+    }
+    center = q.base + (q.height/2)*q.axis;
+    radius = std::sqrt(q.radius*q.radius + q.height*q.height/4);
+}
+
+inline quadric_shape make_quadric(quadric_type type, const vec3& base, const vec3& axis, real radius,
+                                  real height, bool capped, int mat_id) {
+    return { type, base, unit_vector(axis), radius, height, capped, mat_id };
+}
+
+class cylinder : public hitable {
+    public:
+        cylinder(const vec3& base, const vec3& axis, real radius, real height, int mat_id, bool capped = false)
+            : shape(make_quadric(QUADRIC_CYLINDER, base, axis, radius, height, capped, mat_id)) {}
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            return hit_cylinder(shape, r, tmin, tmax, rec);
+        }
+        virtual aabb bounding_box() const { return quadric_box(shape); }
+        quadric_shape shape;
+};
+
+class cone : public hitable {
+    public:
+        cone(const vec3& base, const vec3& axis, real radius, real height, int mat_id, bool capped = false)
+            : shape(make_quadric(QUADRIC_CONE, base, axis, radius, height, capped, mat_id)) {}
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            return hit_cone(shape, r, tmin, tmax, rec);
+        }
+        virtual aabb bounding_box() const { return quadric_box(shape); }
+        quadric_shape shape;
+};
+
+class disk : public hitable {
+    public:
+        disk(const vec3& center, const vec3& normal, real radius, int mat_id)
+            : shape(make_quadric(QUADRIC_DISK, center, normal, radius, 0, false, mat_id)) {}
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            return hit_disk(shape, r, tmin, tmax, rec);
+        }
+        virtual aabb bounding_box() const { return quadric_box(shape); }
+        quadric_shape shape;
+};
+
+// A group of quadrics batched like sphere_soa: one ray is run through
+// sphere_soa's kernel against the bounding sphere of 4, 8 or 16 shapes at
+// a time, and only the shapes it may hit get the exact test. The result
+// is exactly what a hitable_list of the same shapes, in the same order,
+// would return.
+class quadric_soa : public hitable {
+    public:
+        void add(const quadric_shape& q) {
+            int i = size();
+            if (i == int(cx.size())) {
+                float nan = std::numeric_limits<float>::quiet_NaN();
+                cx.resize(i + block_size, nan);
+                cy.resize(i + block_size, nan);
+                cz.resize(i + block_size, nan);
+                radii.resize(i + block_size, 0);
+            }
+            // The kernel works in float, so the sphere is grown to cover
+            // the rounding of its centre and radius.
+            vec3 center;
+            real radius;
+            quadric_bounds(q, center, radius);
+            real reach = std::fmax(std::fabs(center[0]), std::fmax(std::fabs(center[1]), std::fabs(center[2])));
+            cx[i] = center[0];
+            cy[i] = center[1];
+            cz[i] = center[2];
+            radii[i] = float(radius + 1e-5*(radius + reach));
+            shapes.push_back(q);
+            bbox = aabb(bbox, quadric_box(q));
+        }
+
+        int size() const { return shapes.size(); }
+
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            vec3 o = r.origin(), d = r.direction();
+            sphere_cull_ray q;
+            q.ox = o[0]; q.oy = o[1]; q.oz = o[2];
+            q.dx = d[0]; q.dy = d[1]; q.dz = d[2];
+            q.a = dot(d, d);
+            q.inv_a = 1.0f / q.a;
+            q.inv_sqrt_a = 1.0f / std::sqrt(q.a);
+            q.tmin = tmin;
+
+            bool hit_anything = false;
+            real closest_so_far = tmax;
+            int n = size();
+            for (int block = 0; block < n; block += block_size) {
+                int count = n - block < block_size ? n - block : block_size;
+                q.tmax = closest_so_far;
+                uint64_t mask = sphere_soa::kernel(&cx[block], &cy[block], &cz[block], &radii[block], count, q);
+                while (mask) {
+                    int i = block + __builtin_ctzll(mask);
+                    mask &= mask - 1;
+                    if (hit_quadric(shapes[i], r, tmin, closest_so_far, rec)) {
+                        hit_anything = true;
+                        closest_so_far = rec.t;
+                    }
+                }
+            }
+            return hit_anything;
+        }
+
+        virtual aabb bounding_box() const { return bbox; }
+
+    private:
+        static const int block_size = 64;
+
+        aligned_vector<float> cx, cy, cz, radii;
+        std::vector<quadric_shape> shapes;
+        aabb bbox;
+};
+
+#endif
@@ -1,9 +1,67 @@
     #ifndef RANDOMH
     #define RANDOMH
 
-    #include <cstdlib>
+    #include <cstdint>
+
+    // xoshiro256+ (Blackman & Vigna). Small, fast and good enough for
+    // floating point samples; the low bits are weak but random_double only
+    // uses the top 53.
+    struct rng_state {
+        uint64_t s[4];
+    };
+
+    constexpr uint64_t splitmix64(uint64_t& x) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // Expands a 64 bit seed into a full state with splitmix64, as recommended
+    // by the xoshiro authors, so nearby seeds give unrelated streams.
+    constexpr rng_state make_rng(uint64_t seed) {
+        rng_state st = {};
+        for (int i = 0; i < 4; i++)
+            st.s[i] = splitmix64(seed);
+        return st;
+    }
+
+    inline uint64_t rng_next(rng_state& st) {
+        uint64_t* s = st.s;
+        uint64_t result = s[0] + s[3];
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = (s[3] << 45) | (s[3] >> 19);
+        return result;
+    }
+
+    inline double rng_double(rng_state& st) {
+        return (rng_next(st) >> 11) * 0x1.0p-53;
+    }
+
+    // Each thread keeps its own generator state so worker threads never
+    // share (or fight over) hidden state the way rand() does.
+    inline rng_state& random_state() {
+        thread_local rng_state state = make_rng(1);
+        return state;
+    }
+
+    inline void seed_random(uint64_t seed) {
+        random_state() = make_rng(seed);
+    }
+
+    // Mixes a render seed with a pixel position so every pixel gets its own
+    // reproducible sequence, whichever thread ends up shading it.
+    inline uint64_t pixel_seed(uint64_t seed, int i, int j) {
+        uint64_t x = seed ^ ((uint64_t(uint32_t(j)) << 32) | uint32_t(i));
+        return splitmix64(x);
+    }
 
     inline double random_double() {
-        return rand() / (RAND_MAX + 1.0);
+        return rng_double(random_state());
     }
-    #endif
\ No newline at end of file
+    #endif
@@ -2,17 +2,23 @@
 #define RAYH
 #include "vec3.h"
 
-class ray
+// A ray over any vector type; ray, over vec3, is the one the renderer uses.
+template <typename V>
+class ray_t
 {
     public:
-        ray() {}
-        ray(const vec3& a, const vec3& b) { A = a; B = b; }
-        vec3 origin() const       { return A; }
-        vec3 direction() const    { return B; }
-        vec3 point_at_parameter(float t) const { return A + t*B; }
+        typedef typename V::value_type value_type;
 
-        vec3 A;
-        vec3 B;
+        ray_t() {}
+        ray_t(const V& a, const V& b) { A = a; B = b; }
+        V origin() const       { return A; }
+        V direction() const    { return B; }
+        V point_at_parameter(value_type t) const { return A + t*B; }
+
+        V A;
+        V B;
 };
 
-#endif
\ No newline at end of file
+typedef ray_t<vec3> ray;
+
+#endif
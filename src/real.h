@@ -0,0 +1,13 @@
+#ifndef REALH
+#define REALH
+
+// The floating point type of the geometry: vectors, rays, intervals, ray
+// parameters and hit records. float by default; building with REAL_DOUBLE
+// gives a double precision reference build.
+#ifdef REAL_DOUBLE
+typedef double real;
+#else
+typedef float real;
+#endif
+
+#endif
@@ -0,0 +1,506 @@
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "scene_file.h"
+
+namespace {
+
+// A run of characters in the file being parsed.
+struct token {
+    const char* begin;
+    const char* end;
+
+    bool operator==(const char* s) const {
+        size_t n = strlen(s);
+        return size_t(end - begin) == n && memcmp(begin, s, n) == 0;
+    }
+    std::string str() const { return std::string(begin, end); }
+    std::string_view view() const { return std::string_view(begin, end - begin); }
+};
+
+bool parse_float(const token& t, float& value) {
+    // from_chars doesn't take a leading '+', which hand-written files might.
+    const char* b = t.begin < t.end && *t.begin == '+' ? t.begin + 1 : t.begin;
+    std::from_chars_result r = std::from_chars(b, t.end, value);
+    return r.ec == std::errc() && r.ptr == t.end;
+}
+
+bool read_file(const std::string& path, std::string& contents) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    bool ok = fseek(f, 0, SEEK_END) == 0;
+    long n = ok ? ftell(f) : -1;
+    ok = n >= 0 && fseek(f, 0, SEEK_SET) == 0;
+    if (ok) {
+        contents.resize(n);
+        ok = fread(&contents[0], 1, n, f) == size_t(n);
+    }
+    fclose(f);
+    return ok;
+}
+
+// Parses statements one line at a time. Each line is split into tokens in
+// place; numbers are converted straight from the file's bytes, and names
+// are looked up as views of them, so a line costs no allocations.
+class scene_text_parser {
+    public:
+        scene_text_parser(const std::string& path, scene_description& out) : path(path), out(out) {}
+
+        bool parse(const std::string& text, std::string& error) {
+            out = scene_description();
+            const char* p = text.data();
+            const char* end = p + text.size();
+            for (line = 1; p < end; line++) {
+                const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+                if (!eol)
+                    eol = end;
+                tokenize(p, eol);
+                if (!tokens.empty() && !statement()) {
+                    error = path + ":" + std::to_string(line) + ": " + message;
+                    return false;
+                }
+                p = eol + 1;
+            }
+            return true;
+        }
+
+    private:
+        void tokenize(const char* p, const char* end) {
+            tokens.clear();
+            while (p < end) {
+                while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+                    p++;
+                if (p == end || *p == '#')
+                    break;
+                const char* b = p;
+                while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '#')
+                    p++;
+                tokens.push_back({ b, p });
+            }
+        }
+
+        bool fail(const std::string& m) {
+            message = m;
+            return false;
+        }
+
+        bool floats(size_t first, int n, float* values) {
+            if (tokens.size() < first + n)
+                return fail("expected " + std::to_string(n) + " numbers after " + tokens[first - 1].str());
+            for (int k = 0; k < n; k++)
+                if (!parse_float(tokens[first + k], values[k]))
+                    return fail("bad number '" + tokens[first + k].str() + "'");
+            return true;
+        }
+
+        bool statement() {
+            const token& keyword = tokens[0];
+            if (keyword == "sphere")
+                return sphere_statement();
+            if (keyword == "material")
+                return material_statement();
+            if (keyword == "texture")
+                return texture_statement();
+            if (keyword == "camera")
+                return camera_statement();
+            return fail("unknown statement '" + keyword.str() + "'");
+        }
+
+        // sphere x y z radius (material | type parameters)
+        // A material given in place is added to the table unnamed.
+        bool sphere_statement() {
+            if (tokens.size() < 6)
+                return fail("sphere takes a center, a radius and a material");
+            scene_sphere s;
+            float v[4];
+            if (!floats(1, 4, v))
+                return false;
+            s.center[0] = v[0];
+            s.center[1] = v[1];
+            s.center[2] = v[2];
+            s.radius = v[3];
+            if (is_material_type(tokens[5])) {
+                if (!material_args(5))
+                    return false;
+                s.material = int(out.materials.size()) - 1;
+            }
+            else {
+                if (tokens.size() != 6)
+                    return fail("sphere takes a center, a radius and a material");
+                auto m = material_ids.find(tokens[5].view());
+                if (m == material_ids.end())
+                    return fail("unknown material '" + tokens[5].str() + "'");
+                s.material = m->second;
+            }
+            out.spheres.push_back(s);
+            return true;
+        }
+
+        // material name type parameters
+        bool material_statement() {
+            if (tokens.size() < 3)
+                return fail("material takes a name and a type");
+            if (is_material_type(tokens[1]))
+                return fail("a material can't be called '" + tokens[1].str() + "'");
+            if (material_ids.count(tokens[1].view()))
+                return fail("material '" + tokens[1].str() + "' is already defined");
+            if (!material_args(2))
+                return false;
+            material_ids.emplace(tokens[1].view(), int(out.materials.size()) - 1);
+            return true;
+        }
+
+        static bool is_material_type(const token& t) {
+            return t == "lambertian" || t == "metal" || t == "dielectric";
+        }
+
+        // Adds the material the rest of the line describes, from
+        // tokens[first] on, one of
+        //     lambertian|metal (r g b | texture)
+        //     dielectric ref_idx
+        bool material_args(size_t first) {
+            scene_material m = {};
+            int32_t image = -1;
+            const token& type = tokens[first];
+            size_t n = tokens.size() - first - 1;
+            if (type == "lambertian" || type == "metal") {
+                m.type = type == "metal" ? MAT_METAL : MAT_LAMBERTIAN;
+                if (n == 1) {
+                    auto t = textures.find(tokens[first + 1].view());
+                    if (t == textures.end())
+                        return fail("unknown texture '" + tokens[first + 1].str() + "'");
+                    if (t->second.image >= 0 && m.type != MAT_LAMBERTIAN)
+                        return fail("only a lambertian takes an image texture");
+                    std::copy(t->second.colour.begin(), t->second.colour.end(), m.albedo);
+                    image = t->second.image;
+                }
+                else if (n != 3)
+                    return fail(type.str() + " takes a colour or a texture");
+                else if (!floats(first + 1, 3, m.albedo))
+                    return false;
+            }
+            else if (type == "dielectric") {
+                m.type = MAT_DIELECTRIC;
+                m.albedo[0] = m.albedo[1] = m.albedo[2] = 1;  // as dielectric() sets it
+                if (n != 1)
+                    return fail("dielectric takes a refractive index");
+                if (!floats(first + 1, 1, &m.ref_idx))
+                    return false;
+            }
+            else
+                return fail("unknown material type '" + type.str() + "'");
+            // material_textures starts with the first textured material.
+            if (image >= 0 || !out.material_textures.empty()) {
+                out.material_textures.resize(out.materials.size(), -1);
+                out.material_textures.push_back(image);
+            }
+            out.materials.push_back(m);
+            return true;
+        }
+
+        // texture name constant r g b
+        // texture name image path
+        bool texture_statement() {
+            texture_def t = { { 1, 1, 1 }, -1 };
+            if (tokens.size() == 6 && tokens[2] == "constant") {
+                if (!floats(3, 3, t.colour.data()))
+                    return false;
+            }
+            else if (tokens.size() == 4 && tokens[2] == "image") {
+                // Relative to the scene file.
+                std::string file = tokens[3].str();
+                size_t slash = path.rfind('/');
+                if (file[0] != '/' && slash != std::string::npos)
+                    file = path.substr(0, slash + 1) + file;
+                t.image = int(out.texture_paths.size());
+                out.texture_paths.push_back(file);
+            }
+            else
+                return fail("texture takes a name and 'constant' and a colour or 'image' and a file");
+            if (!textures.emplace(tokens[1].view(), t).second)
+                return fail("texture '" + tokens[1].str() + "' is already defined");
+            return true;
+        }
+
+        // camera [lookfrom x y z] [lookat x y z] [vup x y z] [vfov degrees]
+        bool camera_statement() {
+            scene_camera& c = out.camera;
+            c = { { -2, 2, 1 }, { 0, 0, -1 }, { 0, 1, 0 }, 90 };
+            for (size_t k = 1; k < tokens.size(); ) {
+                const token& key = tokens[k];
+                if (key == "lookfrom" || key == "lookat" || key == "vup") {
+                    float* v = key == "lookfrom" ? c.lookfrom : key == "lookat" ? c.lookat : c.vup;
+                    if (!floats(k + 1, 3, v))
+                        return false;
+                    k += 4;
+                }
+                else if (key == "vfov") {
+                    if (!floats(k + 1, 1, &c.vfov))
+                        return false;
+                    k += 2;
+                }
+                else
+                    return fail("unknown camera setting '" + key.str() + "'");
+            }
+            out.has_camera = true;
+            return true;
+        }
+
+        std::string path;
+        scene_description& out;
+        int line;
+        std::vector<token> tokens;
+        std::string message;
+        // Keys point into the text, which outlives the parser.
+        std::unordered_map<std::string_view, int> material_ids;
+        struct texture_def {
+            std::array<float, 3> colour;
+            int32_t image;  // index into texture_paths, or -1 for a constant
+        };
+        std::unordered_map<std::string_view, texture_def> textures;
+};
+
+const char scene_magic[4] = { 'R', 'T', 'S', 'B' };
+
+}
+
+bool read_scene_text(const std::string& path, scene_description& out, std::string& error) {
+    std::string text;
+    if (!read_file(path, text)) {
+        error = "could not read " + path;
+        return false;
+    }
+    return scene_text_parser(path, out).parse(text, error);
+}
+
+// Writes material k's type and parameters.
+static void print_material(FILE* f, const scene_view& v, int k) {
+    const scene_material& m = v.materials[k];
+    if (m.type == MAT_DIELECTRIC)
+        fprintf(f, "dielectric %.9g", m.ref_idx);
+    else if (v.material_textures && v.material_textures[k] >= 0)
+        fprintf(f, "lambertian t%d", v.material_textures[k]);
+    else
+        fprintf(f, "%s %.9g %.9g %.9g", m.type == MAT_METAL ? "metal" : "lambertian",
+                m.albedo[0], m.albedo[1], m.albedo[2]);
+}
+
+bool write_scene_text(const std::string& path, const scene_view& v) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+    // %.9g prints every float exactly, so the text reads back bit for bit.
+    if (v.has_camera) {
+        const scene_camera& c = v.camera;
+        fprintf(f, "camera lookfrom %.9g %.9g %.9g lookat %.9g %.9g %.9g vup %.9g %.9g %.9g vfov %.9g\n",
+                c.lookfrom[0], c.lookfrom[1], c.lookfrom[2], c.lookat[0], c.lookat[1], c.lookat[2],
+                c.vup[0], c.vup[1], c.vup[2], c.vfov);
+    }
+    // Texture paths are written as given, so the text is best saved next
+    // to the file it was read from.
+    for (int k = 0; k < v.texture_count; k++)
+        fprintf(f, "texture t%d image %s\n", k, v.texture_paths[k].c_str());
+    // A material used by exactly one sphere is written in place, the rest
+    // are named. Table order can change, but not what each sphere gets.
+    std::vector<int> uses(v.material_count);
+    for (size_t k = 0; k < v.sphere_count; k++)
+        uses[v.spheres[k].material]++;
+    for (int k = 0; k < v.material_count; k++) {
+        if (uses[k] != 1) {
+            fprintf(f, "material m%d ", k);
+            print_material(f, v, k);
+            fputc('\n', f);
+        }
+    }
+    for (size_t k = 0; k < v.sphere_count; k++) {
+        const scene_sphere& s = v.spheres[k];
+        fprintf(f, "sphere %.9g %.9g %.9g %.9g ", s.center[0], s.center[1], s.center[2], s.radius);
+        if (uses[s.material] == 1)
+            print_material(f, v, s.material);
+        else
+            fprintf(f, "m%d", s.material);
+        fputc('\n', f);
+    }
+    return fclose(f) == 0;
+}
+
+bool write_scene_binary(const std::string& path, const scene_view& v) {
+    for (int k = 0; v.material_textures && k < v.material_count; k++)
+        if (v.material_textures[k] >= 0)
+            return false;
+    scene_file_header h = {};
+    memcpy(h.magic, scene_magic, 4);
+    h.version = scene_file_version;
+    h.has_camera = v.has_camera;
+    h.material_count = v.material_count;
+    h.sphere_count = v.sphere_count;
+    h.camera = v.camera;
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+        && fwrite(v.materials, sizeof(scene_material), v.material_count, f) == size_t(v.material_count)
+        && fwrite(v.spheres, sizeof(scene_sphere), v.sphere_count, f) == v.sphere_count;
+    return fclose(f) == 0 && ok;
+}
+
+bool is_binary_scene_file(const std::string& path) {
+    char magic[4];
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    bool binary = fread(magic, 1, 4, f) == 4 && memcmp(magic, scene_magic, 4) == 0;
+    fclose(f);
+    return binary;
+}
+
+bool mapped_scene_file::open(const std::string& path, std::string& error) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "could not open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(scene_file_header)) {
+        ::close(fd);
+        error = path + " is too short for a scene file";
+        return false;
+    }
+    size = st.st_size;
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        error = "could not map " + path;
+        return false;
+    }
+
+    const scene_file_header* h = static_cast<const scene_file_header*>(data);
+    size_t room = size - sizeof(scene_file_header);
+    if (memcmp(h->magic, scene_magic, 4) != 0 || h->version != scene_file_version)
+        error = path + " is not a version " + std::to_string(scene_file_version) + " binary scene";
+    else if (h->material_count > room / sizeof(scene_material)
+             || h->sphere_count > (room - h->material_count*sizeof(scene_material)) / sizeof(scene_sphere))
+        error = path + " is truncated";
+    if (error.empty()) {
+        scene_view v = view();
+        for (int k = 0; k < v.material_count && error.empty(); k++)
+            if (v.materials[k].type < 0 || v.materials[k].type >= MAT_TYPE_COUNT)
+                error = path + ": material " + std::to_string(k) + " has an unknown type";
+        for (size_t k = 0; k < v.sphere_count && error.empty(); k++)
+            if (v.spheres[k].material < 0 || v.spheres[k].material >= v.material_count)
+                error = path + ": sphere " + std::to_string(k) + " has no material";
+    }
+    if (!error.empty()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void mapped_scene_file::close() {
+    if (data)
+        munmap(data, size);
+    data = nullptr;
+    size = 0;
+}
+
+scene_view mapped_scene_file::view() const {
+    const scene_file_header* h = static_cast<const scene_file_header*>(data);
+    const char* records = static_cast<const char*>(data) + sizeof(scene_file_header);
+    scene_view v;
+    v.has_camera = h->has_camera != 0;
+    v.camera = h->camera;
+    v.materials = reinterpret_cast<const scene_material*>(records);
+    v.material_count = h->material_count;
+    v.spheres = reinterpret_cast<const scene_sphere*>(records + h->material_count*sizeof(scene_material));
+    v.sphere_count = h->sphere_count;
+    v.texture_paths = nullptr;
+    v.texture_count = 0;
+    v.material_textures = nullptr;
+    return v;
+}
+
+bool describe_scene(const scene& world, scene_description& out) {
+    out.materials.clear();
+    out.spheres.clear();
+    out.texture_paths.clear();
+    out.material_textures.clear();
+    for (int k = 0; k < world.materials.size(); k++) {
+        const material& m = world.materials[k];
+        if (m.tex)
+            return false;
+        out.materials.push_back({ m.type, { float(m.albedo[0]), float(m.albedo[1]), float(m.albedo[2]) }, m.ref_idx });
+    }
+    out.spheres.reserve(world.list_size);
+    for (int k = 0; k < world.list_size; k++) {
+        const sphere* s = dynamic_cast<const sphere*>(world.list[k]);
+        if (!s)
+            return false;
+        out.spheres.push_back({ { float(s->center[0]), float(s->center[1]), float(s->center[2]) },
+                                float(s->radius), s->mat_id });
+    }
+    return true;
+}
+
+scene* make_scene(const scene_view& v, std::string& error) {
+    scene* world = new scene(int(v.sphere_count));
+    std::vector<const texture*> textures(v.texture_count);
+    for (int k = 0; k < v.texture_count; k++) {
+        textures[k] = world->load_texture(v.texture_paths[k], error);
+        if (!textures[k]) {
+            delete world;
+            return nullptr;
+        }
+    }
+    for (int k = 0; k < v.material_count; k++) {
+        const scene_material& r = v.materials[k];
+        vec3 albedo(r.albedo[0], r.albedo[1], r.albedo[2]);
+        if (v.material_textures && v.material_textures[k] >= 0)
+            world->make_material<lambertian>(textures[v.material_textures[k]]);
+        else if (r.type == MAT_METAL)
+            world->make_material<metal>(albedo);
+        else if (r.type == MAT_DIELECTRIC)
+            world->make_material<dielectric>(r.ref_idx);
+        else
+            world->make_material<lambertian>(albedo);
+    }
+    for (size_t k = 0; k < v.sphere_count; k++) {
+        const scene_sphere& s = v.spheres[k];
+        world->add<sphere>(vec3(s.center[0], s.center[1], s.center[2]), s.radius, s.material);
+    }
+    return world;
+}
+
+scene* load_scene(const std::string& path, bool& has_camera, scene_camera& cam, std::string& error) {
+    scene_view v;
+    mapped_scene_file mapped;
+    scene_description text;
+    if (is_binary_scene_file(path)) {
+        if (!mapped.open(path, error))
+            return nullptr;
+        v = mapped.view();
+    }
+    else {
+        if (!read_scene_text(path, text, error))
+            return nullptr;
+        v = text.view();
+    }
+    has_camera = v.has_camera;
+    cam = v.camera;
+    return make_scene(v, error);
+}
+
+camera make_camera(const scene_camera& c, float aspect) {
+    return camera(vec3(c.lookfrom[0], c.lookfrom[1], c.lookfrom[2]), vec3(c.lookat[0], c.lookat[1], c.lookat[2]),
+                  vec3(c.vup[0], c.vup[1], c.vup[2]), c.vfov, aspect);
+}
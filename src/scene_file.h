@@ -0,0 +1,154 @@
+#ifndef SCENE_FILEH
+#define SCENE_FILEH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "scenes.h"
+
+// Scenes on disk, in two forms holding the same thing: a camera, a
+// material table and a list of spheres.
+//
+// The text form is for writing by hand. One statement per line, # starts
+// a comment:
+//
+//     camera lookfrom -2 2 1 lookat 0 0 -1 vup 0 1 0 vfov 90
+//     texture grey constant 0.5 0.5 0.5
+//     texture earth image maps/earth.png
+//     material ground lambertian grey
+//     material globe lambertian earth
+//     material red lambertian 0.8 0.1 0.1
+//     material gold metal 0.7 0.6 0.5
+//     material glass dielectric 1.5
+//     sphere 0 -1000 0 1000 ground
+//     sphere 0 1 0 1 glass
+//     sphere 4 1 0 1 metal 0.7 0.6 0.5
+//
+// Names are declared before use. A sphere names its material or gives one
+// in place, as the last sphere does. A lambertian or metal takes a colour
+// or the name of a texture. Constant textures are folded into the
+// material's albedo when the file is read. Image textures are PPM or PNG
+// files, relative to the scene file, whose path can't hold spaces; only a
+// lambertian takes one, and they are loaded into the scene's texture_cache
+// when it is built.
+//
+// The binary form is the same data laid out to be mapped and used in
+// place: a scene_file_header, then material_count scene_material records,
+// then sphere_count scene_sphere records, all in host byte order.
+// mapped_scene_file maps one and hands out pointers into the mapping. It
+// has no image textures.
+
+struct scene_camera {
+    float lookfrom[3];
+    float lookat[3];
+    float vup[3];
+    float vfov;    // degrees, top to bottom
+};
+
+struct scene_material {
+    int32_t type;       // material_type
+    float albedo[3];    // lambertian, metal
+    float ref_idx;      // dielectric
+};
+
+struct scene_sphere {
+    float center[3];
+    float radius;
+    int32_t material;   // index into the material records
+};
+
+struct scene_file_header {
+    char magic[4];           // "RTSB"
+    uint32_t version;
+    uint32_t has_camera;
+    uint32_t material_count;
+    uint64_t sphere_count;
+    scene_camera camera;
+};
+
+static_assert(sizeof(scene_material) == 20, "scene_material is part of the file format");
+static_assert(sizeof(scene_sphere) == 20, "scene_sphere is part of the file format");
+static_assert(sizeof(scene_file_header) == 64, "scene_file_header is part of the file format");
+
+const uint32_t scene_file_version = 1;
+
+// A scene's records wherever they live: in a scene_description's vectors
+// or in a mapped binary file.
+struct scene_view {
+    bool has_camera;
+    scene_camera camera;
+    const scene_material* materials;
+    int material_count;
+    const scene_sphere* spheres;
+    size_t sphere_count;
+    // Image texture files, and for each material the index of its texture
+    // or -1. material_textures is null if no material has one.
+    const std::string* texture_paths;
+    int texture_count;
+    const int32_t* material_textures;
+};
+
+// A scene read from text, or built in code to be saved.
+struct scene_description {
+    bool has_camera = false;
+    scene_camera camera = {};
+    std::vector<scene_material> materials;
+    std::vector<scene_sphere> spheres;
+    std::vector<std::string> texture_paths;
+    std::vector<int32_t> material_textures;  // empty, or one per material
+
+    scene_view view() const {
+        return { has_camera, camera, materials.data(), int(materials.size()), spheres.data(), spheres.size(),
+                 texture_paths.data(), int(texture_paths.size()),
+                 material_textures.empty() ? nullptr : material_textures.data() };
+    }
+};
+
+// A binary scene file mapped read-only. The view points into the mapping,
+// so it is valid for as long as this object is open.
+class mapped_scene_file {
+    public:
+        mapped_scene_file() : data(nullptr), size(0) {}
+        ~mapped_scene_file() { close(); }
+        mapped_scene_file(const mapped_scene_file&) = delete;
+        mapped_scene_file& operator=(const mapped_scene_file&) = delete;
+
+        // Maps path and checks the header and that every record is in
+        // bounds. On failure returns false with the reason in error.
+        bool open(const std::string& path, std::string& error);
+        void close();
+        scene_view view() const;
+
+    private:
+        void* data;
+        size_t size;
+};
+
+bool read_scene_text(const std::string& path, scene_description& out, std::string& error);
+bool write_scene_text(const std::string& path, const scene_view& v);
+// Fails if a material has an image texture, which the binary form can't
+// hold.
+bool write_scene_binary(const std::string& path, const scene_view& v);
+
+// True if path starts with the binary form's magic number.
+bool is_binary_scene_file(const std::string& path);
+
+// The records for a scene built in code. Fails if the scene holds anything
+// other than spheres, or image textures, whose files it doesn't know.
+bool describe_scene(const scene& world, scene_description& out);
+
+// Builds a renderable scene from records: one material per record, and the
+// spheres packed into the scene's arena in file order. Returns nullptr with
+// the reason in error if a texture can't be read.
+scene* make_scene(const scene_view& v, std::string& error);
+
+// Reads either form, told apart by the magic number, and builds the scene.
+// Fills in the camera if the file has one. Returns nullptr with the reason
+// in error on failure.
+scene* load_scene(const std::string& path, bool& has_camera, scene_camera& cam, std::string& error);
+
+camera make_camera(const scene_camera& c, float aspect);
+
+#endif
@@ -0,0 +1,76 @@
+#include "scenes.h"
+#include "instance.h"
+#include "triangle_mesh.h"
+
+scene* random_scene(int extent) {
+    scene* world = new scene(4*extent*extent + 4);
+    world->add<sphere>(vec3(0,-1000,0), 1000, world->make_material<lambertian>(vec3(0.5, 0.5, 0.5)));
+    for(int a = -extent; a < extent; a++){
+        for(int b = -extent; b < extent; b++){
+            float choose_mat = random_double();
+            vec3 center(a+0.9*random_double(), 0.2, b+0.9*random_double());
+            if((center-vec3(4,0.2,0)).length() > 0.9){
+                if(choose_mat < 0.8){
+                    world->add<sphere>(center, 0.2, world->make_material<lambertian>(vec3(random_double()*random_double(), random_double()*random_double(), random_double()*random_double())));
+                }
+                else if(choose_mat < 0.95){
+                    world->add<sphere>(center, 0.2, world->make_material<metal>(vec3(0.5*(1 + random_double()), 0.5*(1 + random_double()), 0.5*(1 + random_double()))));
+                }
+                else{
+                    world->add<sphere>(center, 0.2, world->make_material<dielectric>(1.5));
+                }
+            }
+        }
+    }
+
+    world->add<sphere>(vec3(0, 1, 0), 1.0, world->make_material<dielectric>(1.5));
+    world->add<sphere>(vec3(-4, 1, 0), 1.0, world->make_material<lambertian>(vec3(0.4, 0.2, 0.1)));
+    world->add<sphere>(vec3(4, 1, 0), 1.0, world->make_material<metal>(vec3(0.7, 0.6, 0.5)));
+
+    return world;
+}
+
+scene* instanced_scene(int extent) {
+    scene* world = new scene(4*extent*extent + 4);
+    world->add<sphere>(vec3(0,-1000,0), 1000, world->make_material<lambertian>(vec3(0.5, 0.5, 0.5)));
+
+    // Made in the arena but not added to the list: they are only seen
+    // through instances.
+    std::vector<vec3> vertices;
+    std::vector<int32_t> indices;
+    const hitable* shapes[2];
+    sphere_mesh(vec3(0, 0, 0), 1, 32, 16, vertices, indices);
+    shapes[0] = world->primitives.make<triangle_mesh>(vertices, indices, 0);
+    sphere_mesh(vec3(0, 0, 0), 1, 6, 3, vertices, indices);
+    shapes[1] = world->primitives.make<triangle_mesh>(vertices, indices, 0);
+
+    const int palette_size = 16;
+    int palette[palette_size];
+    for (int k = 0; k < palette_size; k++) {
+        if (k < 12)
+            palette[k] = world->make_material<lambertian>(vec3(random_double()*random_double(), random_double()*random_double(), random_double()*random_double()));
+        else if (k < 15)
+            palette[k] = world->make_material<metal>(vec3(0.5*(1 + random_double()), 0.5*(1 + random_double()), 0.5*(1 + random_double())));
+        else
+            palette[k] = world->make_material<dielectric>(1.5);
+    }
+
+    for(int a = -extent; a < extent; a++){
+        for(int b = -extent; b < extent; b++){
+            vec3 center(a+0.9*random_double(), 0.2, b+0.9*random_double());
+            if((center-vec3(4,0.2,0)).length() > 0.9){
+                const hitable* shape = shapes[random_double() < 0.5 ? 0 : 1];
+                affine_transform place = affine_transform::translation(center)
+                                       * affine_transform::rotation_y(360*random_double())
+                                       * affine_transform::scaling(0.2);
+                world->add<instance>(shape, place, palette[int(palette_size*random_double())]);
+            }
+        }
+    }
+
+    world->add<sphere>(vec3(0, 1, 0), 1.0, world->make_material<dielectric>(1.5));
+    world->add<sphere>(vec3(-4, 1, 0), 1.0, world->make_material<lambertian>(vec3(0.4, 0.2, 0.1)));
+    world->add<sphere>(vec3(4, 1, 0), 1.0, world->make_material<metal>(vec3(0.7, 0.6, 0.5)));
+
+    return world;
+}
@@ -0,0 +1,76 @@
+#ifndef SCENESH
+#define SCENESH
+
+#include <algorithm>
+#include <string>
+#include "arena.h"
+#include "sphere.h"
+#include "hitablelist.h"
+#include "random.h"
+#include "lambertian.h"
+#include "metal.h"
+#include "dielectric.h"
+#include "material.h"
+#include "texture.h"
+
+// A hitable_list that owns everything it points to. Primitives come from
+// an arena, so the spheres a ray is tested against are packed together,
+// and materials are stored by value in the material table. Image textures
+// live in the texture cache. Deleting the scene frees all of it.
+class scene : public hitable_list {
+    public:
+        scene(int capacity) {
+            list = primitives.make_array<hitable*>(capacity);
+            list_size = 0;
+            this->capacity = capacity;
+        }
+
+        // Builds a primitive in the scene and adds it to the list. The list
+        // doubles (leaving the old copy in the arena) if capacity runs out.
+        template <typename T, typename... Args>
+        T* add(Args&&... args) {
+            T* object = primitives.make<T>(std::forward<Args>(args)...);
+            if (list_size == capacity) {
+                capacity = capacity > 0 ? 2*capacity : 16;
+                hitable** grown = primitives.make_array<hitable*>(capacity);
+                std::copy(list, list + list_size, grown);
+                list = grown;
+            }
+            list[list_size++] = object;
+            return object;
+        }
+
+        // Adds a material to the table and returns its id.
+        template <typename T, typename... Args>
+        int make_material(Args&&... args) {
+            return materials.add(T(std::forward<Args>(args)...));
+        }
+
+        // Loads a PPM or PNG image into the texture cache and returns a
+        // texture for it to give a lambertian. Returns nullptr with the
+        // reason in error on failure.
+        const texture* load_texture(const std::string& path, std::string& error) {
+            int id = textures.add(path, error);
+            return id < 0 ? nullptr : primitives.make<image_texture>(&textures, id);
+        }
+
+        int capacity;
+        arena primitives;
+        material_table materials;
+        texture_cache textures;
+};
+
+// The final scene from "Ray Tracing in One Weekend": a grid of small random
+// spheres around three big ones. extent sets the half width of the grid, so
+// the default of 11 gives about 500 spheres and the count grows as extent^2.
+// The caller owns the returned scene.
+scene* random_scene(int extent = 11);
+
+// The same layout with the small spheres replaced by instances of two
+// shared meshes, a smooth sphere and a faceted one, each turned at random
+// and given one of a fixed palette of materials. Memory grows with the
+// instance count only by an instance and its share of the top-level tree
+// per object; the meshes and materials are made once.
+scene* instanced_scene(int extent = 11);
+
+#endif
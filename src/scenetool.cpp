@@ -0,0 +1,56 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include "scene_file.h"
+#include "scenes.h"
+using namespace std;
+
+// Writes scene files: converts between the text and binary forms, or dumps
+// random_scene() with ch5's camera. The output form follows the extension,
+// binary for .rtsb and text otherwise.
+
+bool ends_with(const string& s, const string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char** argv) {
+    string usage = string("usage: ") + argv[0] + " input.{scene,rtsb} output.{scene,rtsb}\n"
+                 + "       " + argv[0] + " -random [extent] output.{scene,rtsb}\n";
+    if (argc < 3 || argc > 4 || (argc == 4 && string(argv[1]) != "-random")) {
+        cerr << usage;
+        return 1;
+    }
+    string output = argv[argc - 1];
+
+    scene_description desc;
+    mapped_scene_file mapped;
+    scene_view v;
+    if (string(argv[1]) == "-random") {
+        scene* world = random_scene(argc == 4 ? atoi(argv[2]) : 11);
+        describe_scene(*world, desc);
+        desc.has_camera = true;
+        desc.camera = { { -2, 2, 1 }, { 0, 0, -1 }, { 0, 1, 0 }, 90 };
+        v = desc.view();
+    }
+    else {
+        string error;
+        bool binary = is_binary_scene_file(argv[1]);
+        if (!(binary ? mapped.open(argv[1], error) : read_scene_text(argv[1], desc, error))) {
+            cerr << error << "\n";
+            return 1;
+        }
+        v = binary ? mapped.view() : desc.view();
+    }
+
+    bool binary = ends_with(output, ".rtsb");
+    if (binary && v.material_textures) {
+        cerr << "binary scenes can't hold image textures\n";
+        return 1;
+    }
+    bool ok = binary ? write_scene_binary(output, v) : write_scene_text(output, v);
+    if (!ok) {
+        cerr << "could not write " << output << "\n";
+        return 1;
+    }
+    cerr << v.material_count << " materials, " << v.sphere_count << " spheres\n";
+}
@@ -0,0 +1,398 @@
+#ifndef SDFH
+#define SDFH
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "hitable.h"
+#include "perlin.h"
+
+// Shapes given by a signed distance field: negative inside, positive
+// outside, never more than lipschitz times the true distance to the
+// surface. A field is a tree of the nodes below, stored by value in an
+// sdf_tree and named by index like materials in a material_table, so one
+// tree can hold many shapes that share parts.
+//
+// Each node also records a sphere holding its surface. A union evaluates
+// the child whose sphere is nearer first and skips the other whenever its
+// sphere is already farther away than that value, and a child far outside
+// its sphere isn't evaluated at all, so a union of many shapes only does
+// the work for the ones near the point. Skipping assumes children are
+// true distances outside their spheres, as all the primitives are, and
+// stay so under displacement and blending.
+enum sdf_op {
+    SDF_SPHERE,         // center, size[0] = radius
+    SDF_BOX,            // center, size = half extents
+    SDF_TORUS,          // center, size[0] = major, size[1] = minor, around y
+    SDF_UNION,          // a, b
+    SDF_SMOOTH_UNION,   // a, b, k = blend width
+    SDF_INTERSECTION,   // a, b
+    SDF_SUBTRACTION,    // a minus b
+    SDF_DISPLACE        // a, k = amplitude, frequency
+};
+
+struct sdf_node {
+    sdf_op op;
+    int a, b;
+    vec3 center;
+    vec3 size;
+    real k;
+    real frequency;
+
+    vec3 bound_center;
+    real bound_radius;
+    real lipschitz;
+};
+
+// Gradient noise for displacement. The displacement's lipschitz bound
+// needs how steep it can get: the steepest of 2e7 random points was 2.8.
+inline real displacement_noise(const vec3& p) {
+    static constexpr perlin noise;
+    return noise.noise(p);
+}
+const real displacement_noise_slope = 3;
+
+class sdf_tree {
+    public:
+        int sphere(const vec3& center, real radius) {
+            return add(primitive(SDF_SPHERE, center, vec3(radius, 0, 0), radius));
+        }
+
+        int box(const vec3& center, const vec3& half) {
+            return add(primitive(SDF_BOX, center, half, half.length()));
+        }
+
+        int torus(const vec3& center, real major, real minor) {
+            return add(primitive(SDF_TORUS, center, vec3(major, minor, 0), major + minor));
+        }
+
+        int join(int a, int b) { return add(combine(SDF_UNION, a, b, 0)); }
+        int smooth_join(int a, int b, real k) { return add(combine(SDF_SMOOTH_UNION, a, b, k)); }
+        int intersect(int a, int b) { return add(combine(SDF_INTERSECTION, a, b, 0)); }
+        int subtract(int a, int b) { return add(combine(SDF_SUBTRACTION, a, b, 0)); }
+
+        // Moves a's surface in and out by up to amplitude, following noise
+        // with frequency lattice cells per unit.
+        int displace(int a, real amplitude, real frequency) {
+            sdf_node n = nodes[a];
+            n.op = SDF_DISPLACE;
+            n.a = a;
+            n.k = amplitude;
+            n.frequency = frequency;
+            n.bound_radius += amplitude;
+            n.lipschitz += amplitude * frequency * displacement_noise_slope;
+            return add(n);
+        }
+
+        const sdf_node& operator[](int i) const { return nodes[i]; }
+
+        real distance(int i, const vec3& p) const {
+            const sdf_node& n = nodes[i];
+            switch (n.op) {
+                case SDF_SPHERE:
+                    return (p - n.center).length() - n.size[0];
+                case SDF_BOX: {
+                    vec3 q = p - n.center;
+                    real outside = 0, inside = -INFINITY;
+                    for (int axis = 0; axis < 3; axis++) {
+                        real d = std::fabs(q[axis]) - n.size[axis];
+                        outside += d > 0 ? d*d : 0;
+                        inside = std::max(inside, d);
+                    }
+                    return std::sqrt(outside) + std::min(inside, real(0));
+                }
+                case SDF_TORUS: {
+                    vec3 q = p - n.center;
+                    real ring = std::sqrt(q[0]*q[0] + q[2]*q[2]) - n.size[0];
+                    return std::sqrt(ring*ring + q[1]*q[1]) - n.size[1];
+                }
+                case SDF_UNION:
+                case SDF_SMOOTH_UNION: {
+                    // Nearer child first; the other can only matter if its
+                    // sphere comes within the blend width of that value.
+                    int first = n.a, second = n.b;
+                    real first_bound = sphere_bound(first, p), second_bound = sphere_bound(second, p);
+                    if (second_bound < first_bound) {
+                        std::swap(first, second);
+                        std::swap(first_bound, second_bound);
+                    }
+                    real d1 = child_distance(first, p, first_bound, n.k);
+                    if (second_bound >= d1 + n.k)
+                        return d1;
+                    real d2 = child_distance(second, p, second_bound, n.k);
+                    if (n.op == SDF_UNION)
+                        return std::min(d1, d2);
+                    // Polynomial smooth minimum: exact min once the two are
+                    // k apart, and at most k/4 below it where they blend.
+                    real h = std::max(n.k - std::fabs(d1 - d2), real(0)) / n.k;
+                    return std::min(d1, d2) - h*h*n.k/4;
+                }
+                case SDF_INTERSECTION:
+                    return std::max(distance(n.a, p), distance(n.b, p));
+                case SDF_SUBTRACTION:
+                    return std::max(distance(n.a, p), -distance(n.b, p));
+                default:
+                    return distance(n.a, p) - n.k * displacement_noise(n.frequency * p);
+            }
+        }
+
+    private:
+        std::vector<sdf_node> nodes;
+
+        int add(const sdf_node& n) {
+            nodes.push_back(n);
+            return int(nodes.size()) - 1;
+        }
+
+        // How far p is at least from the surface in node i's sphere.
+        real sphere_bound(int i, const vec3& p) const {
+            return (p - nodes[i].bound_center).length() - nodes[i].bound_radius;
+        }
+
+        // A union child's value: well away from its sphere, the distance to
+        // the sphere instead. That is still a lower bound, which is all
+        // tracing needs there, and it is too far off to change any blend.
+        real child_distance(int i, const vec3& p, real bound, real k) const {
+            if (bound > std::max(nodes[i].bound_radius, k))
+                return bound;
+            return distance(i, p);
+        }
+
+        static sdf_node primitive(sdf_op op, const vec3& center, const vec3& size, real radius) {
+            sdf_node n = {};
+            n.op = op;
+            n.a = n.b = -1;
+            n.center = center;
+            n.size = size;
+            n.bound_center = center;
+            n.bound_radius = radius;
+            n.lipschitz = 1;
+            return n;
+        }
+
+        sdf_node combine(sdf_op op, int a, int b, real k) const {
+            const sdf_node& na = nodes[a];
+            const sdf_node& nb = nodes[b];
+            sdf_node n = {};
+            n.op = op;
+            n.a = a;
+            n.b = b;
+            n.k = k;
+            n.lipschitz = std::max(na.lipschitz, nb.lipschitz);
+            if (op == SDF_SUBTRACTION) {
+                n.bound_center = na.bound_center;
+                n.bound_radius = na.bound_radius;
+            } else if (op == SDF_INTERSECTION) {
+                const sdf_node& smaller = na.bound_radius < nb.bound_radius ? na : nb;
+                n.bound_center = smaller.bound_center;
+                n.bound_radius = smaller.bound_radius;
+            } else {
+                // The sphere around both, grown by how far blending can
+                // push the surface out.
+                vec3 offset = nb.bound_center - na.bound_center;
+                real gap = offset.length();
+                if (gap + nb.bound_radius <= na.bound_radius) {
+                    n.bound_center = na.bound_center;
+                    n.bound_radius = na.bound_radius;
+                } else if (gap + na.bound_radius <= nb.bound_radius) {
+                    n.bound_center = nb.bound_center;
+                    n.bound_radius = nb.bound_radius;
+                } else {
+                    n.bound_radius = (gap + na.bound_radius + nb.bound_radius) / 2;
+                    n.bound_center = na.bound_center + offset * ((n.bound_radius - na.bound_radius) / gap);
+                }
+                n.bound_radius += k/4;
+            }
+            return n;
+        }
+};
+
+// A cache of an sdf_tree field over the cube around a shape's sphere, for
+// the steps far from the surface. The cube is cut into blocks; a block
+// entirely clear of the surface, outside or in, keeps one value at its
+// centre, and only blocks the surface may pass through are cut again into
+// cells with a value each, so memory follows the surface's area rather
+// than the cube's volume. Values are distance bounds (field over
+// lipschitz), so the value at a centre c bounds the distance at any p by
+// value - |p - c|.
+class sdf_grid {
+    public:
+        sdf_grid(const sdf_tree& tree, int root, int blocks = 16, int cells = 8)
+            : blocks(blocks), cells(cells) {
+            const sdf_node& n = tree[root];
+            origin = n.bound_center - vec3(n.bound_radius, n.bound_radius, n.bound_radius);
+            block_size = 2*n.bound_radius / blocks;
+            cell_size = block_size / cells;
+            real scale = 1 / n.lipschitz;
+            real half_diagonal = block_size * real(0.8660254);
+            values.resize(blocks*blocks*blocks);
+            refined.assign(blocks*blocks*blocks, -1);
+            for (int i = 0; i < blocks*blocks*blocks; i++) {
+                vec3 corner = origin + block_size*vec3(i % blocks, (i / blocks) % blocks, i / (blocks*blocks));
+                values[i] = tree.distance(root, corner + 0.5*block_size*vec3(1, 1, 1)) * scale;
+                if (std::fabs(values[i]) > half_diagonal)
+                    continue;
+                refined[i] = int(cell_values.size());
+                for (int c = 0; c < cells*cells*cells; c++) {
+                    vec3 center = corner + cell_size*vec3(c % cells + 0.5, (c / cells) % cells + 0.5, c / (cells*cells) + 0.5);
+                    cell_values.push_back(tree.distance(root, center) * scale);
+                }
+            }
+        }
+
+        // A lower bound on the distance from p to the surface, or a
+        // negative number where the cache can't tell. Within a cell of the
+        // surface it never tells, so that tracing stops only on the exact
+        // field.
+        real bound(const vec3& p) const {
+            real b = cached_bound(p);
+            return b > cell_size ? b : -1;
+        }
+
+        size_t memory() const {
+            return values.size()*sizeof(float) + refined.size()*sizeof(int) + cell_values.size()*sizeof(float);
+        }
+
+    private:
+        int blocks, cells;
+        vec3 origin;
+        real block_size, cell_size;
+        std::vector<float> values;
+        std::vector<int> refined;
+        std::vector<float> cell_values;
+
+        real cached_bound(const vec3& p) const {
+            vec3 q = (p - origin) / block_size;
+            int x = int(q[0]), y = int(q[1]), z = int(q[2]);
+            if (q[0] < 0 || q[1] < 0 || q[2] < 0 || x >= blocks || y >= blocks || z >= blocks)
+                return -1;
+            int i = x + blocks*(y + blocks*z);
+            if (refined[i] < 0)
+                return values[i] - (p - (origin + block_size*vec3(x + 0.5, y + 0.5, z + 0.5))).length();
+            vec3 r = (q - vec3(x, y, z)) * real(cells);
+            int cx = std::min(int(r[0]), cells - 1), cy = std::min(int(r[1]), cells - 1), cz = std::min(int(r[2]), cells - 1);
+            vec3 center = origin + block_size*vec3(x, y, z) + cell_size*vec3(cx + 0.5, cy + 0.5, cz + 0.5);
+            return cell_values[refined[i] + cx + cells*(cy + cells*cz)] - (p - center).length();
+        }
+};
+
+// A hitable that sphere-traces one node of an sdf_tree. Rays are clipped
+// to the node's sphere, then stepped forward by the distance bound times
+// relaxation (over-relaxed sphere tracing, Keinert et al. 2014). If a step
+// lands where its unbounding sphere no longer overlaps the previous one,
+// it may have jumped a surface, so the step is retaken from the previous
+// point without relaxation. A ray starting inside traces the surface from
+// within, as refraction needs.
+class sdf_object : public hitable {
+    public:
+        sdf_object(const sdf_tree* tree, int root, int mat_id, const sdf_grid* cache = nullptr)
+            : tree(tree), root(root), mat_id(mat_id), cache(cache) {}
+
+        // The hit's t, and the number of field evaluations it took.
+        bool trace(const ray& r, real tmin, real tmax, real& t_hit, int& steps) const {
+            const sdf_node& n = (*tree)[root];
+            steps = 0;
+            vec3 oc = r.origin() - n.bound_center;
+            real a = dot(r.direction(), r.direction());
+            real b = dot(oc, r.direction());
+            real c = dot(oc, oc) - n.bound_radius*n.bound_radius;
+            real discriminant = b*b - a*c;
+            if (discriminant <= 0)
+                return false;
+            real root_d = std::sqrt(discriminant);
+            real t = std::max(tmin, (-b - root_d) / a);
+            real t_end = std::min(tmax, (-b + root_d) / a);
+            if (t >= t_end)
+                return false;
+
+            real speed = std::sqrt(a);
+            real scale = 1 / (n.lipschitz * speed);
+            real epsilon = precision * n.bound_radius / speed;
+            real sign = 1;
+            real omega = relaxation;
+            real previous_t = t, previous_d = 0;
+            for (; steps < max_steps; steps++) {
+                real d = sign * bound(r.point_at_parameter(t), scale);
+                if (steps == 0 && d < 0) {
+                    sign = -1;
+                    d = -d;
+                }
+                bool overshot = omega > 1 && (d < 0 || d + previous_d < t - previous_t);
+                if (overshot) {
+                    omega = 1;
+                    t = previous_t + previous_d;
+                    continue;
+                }
+                if (d < epsilon) {
+                    if (t <= tmin || t >= tmax)
+                        return false;
+                    t_hit = t;
+                    return true;
+                }
+                previous_t = t;
+                previous_d = d;
+                t += omega * d;
+                if (t >= t_end) {
+                    // A relaxed step may have jumped a surface just short
+                    // of the end, such as the far side seen from inside,
+                    // so retake it plainly and look at the end itself
+                    // before giving up.
+                    if (previous_t >= t_end)
+                        return false;
+                    omega = 1;
+                    t = std::min(previous_t + d, t_end);
+                }
+            }
+            return false;
+        }
+
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            real t;
+            int steps;
+            if (!trace(r, tmin, tmax, t, steps))
+                return false;
+            rec.t = t;
+            rec.p = r.point_at_parameter(t);
+            rec.normal = normal(rec.p);
+            rec.mat_id = mat_id;
+            rec.mapping = UV_NONE;
+            return true;
+        }
+
+        virtual aabb bounding_box() const {
+            const sdf_node& n = (*tree)[root];
+            vec3 reach(n.bound_radius, n.bound_radius, n.bound_radius);
+            return aabb(n.bound_center - reach, n.bound_center + reach);
+        }
+
+        // The field's gradient by differences over a tetrahedron, four
+        // evaluations rather than six.
+        vec3 normal(const vec3& p) const {
+            real h = 10 * precision * (*tree)[root].bound_radius;
+            vec3 k0(1, -1, -1), k1(-1, -1, 1), k2(-1, 1, -1), k3(1, 1, 1);
+            vec3 g = k0*tree->distance(root, p + h*k0) + k1*tree->distance(root, p + h*k1)
+                   + k2*tree->distance(root, p + h*k2) + k3*tree->distance(root, p + h*k3);
+            return unit_vector(g);
+        }
+
+        const sdf_tree* tree;
+        int root;
+        int mat_id;
+        const sdf_grid* cache;
+        real relaxation = 1.25;  // 1 is plain sphere tracing
+        real precision = 1e-4;   // hit tolerance, relative to the bounding radius
+        int max_steps = 256;
+
+    private:
+        // Distance bound in units of t, from the cache when it can tell.
+        real bound(const vec3& p, real scale) const {
+            if (cache) {
+                real cached = cache->bound(p);
+                if (cached > 0)
+                    return cached * scale * (*tree)[root].lipschitz;
+            }
+            return tree->distance(root, p) * scale;
+        }
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef SIMDH
+#define SIMDH
+
+// Which SIMD instruction sets the batch kernels can use. Kernels for each
+// level are compiled with target attributes, so one binary carries them
+// all and picks at run time from what the CPU supports.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+enum simd_level { simd_scalar, simd_sse, simd_avx2, simd_avx512 };
+
+inline const char* simd_level_name(simd_level level) {
+    switch (level) {
+        case simd_sse:    return "sse";
+        case simd_avx2:   return "avx2";
+        case simd_avx512: return "avx512";
+        default:          return "scalar";
+    }
+}
+
+inline simd_level cpu_simd_level() {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return simd_avx512;
+    if (__builtin_cpu_supports("avx2"))    return simd_avx2;
+    if (__builtin_cpu_supports("sse2"))    return simd_sse;
+#endif
+    return simd_scalar;
+}
+
+#endif
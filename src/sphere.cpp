@@ -0,0 +1,5 @@
+#include "sphere.h"
+
+bool sphere::hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+    return hit_sphere(center, radius, mat_id, r, tmin, tmax, rec);
+}
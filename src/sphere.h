@@ -2,49 +2,64 @@
 #define SPHEREH
 
 #include "hitable.h"
-#include "material.h"
 #include "random.h"
 
-class metal;
-
 class sphere : public hitable {
     public:
         sphere() {}
-        sphere(vec3 cen, float r, material* m) : center(cen), radius(r), mat_ptr(m) {};
-        virtual bool hit(const ray& r, float tmin, float tmax, hit_record& rec) const;
+        sphere(vec3 cen, real r, int m) : center(cen), radius(r), mat_id(m) {};
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const;
+        virtual aabb bounding_box() const {
+            vec3 rvec(radius, radius, radius);
+            return aabb(center - rvec, center + rvec);
+        }
         vec3 center;
-        float radius;
-        material *mat_ptr;
+        real radius;
+        int mat_id;
 };
 
-bool sphere::hit(const ray& r, float tmin, float tmax, hit_record& rec) const {
-    vec3 oc = r.origin() - center;
-    float a = dot(r.direction(), r.direction());
-    float b = dot(oc, r.direction());
-    float c = dot(oc, oc) - radius*radius;
-    float discriminant = b*b - a*c;
+// The nearer root of |o + t*d - center| = radius inside (tmin, tmax), for
+// any vector type, so the same solve can run at other precisions (see
+// bench_precision).
+template <typename V, typename T>
+inline bool sphere_root(const V& center, T radius, const ray_t<V>& r, T tmin, T tmax, T& t) {
+    V oc = r.origin() - center;
+    T a = dot(r.direction(), r.direction());
+    T b = dot(oc, r.direction());
+    T c = dot(oc, oc) - radius*radius;
+    T discriminant = b*b - a*c;
     if (discriminant > 0) {
-        float temp = (-b - sqrt(b*b-a*c))/a;
+        T temp = (-b - sqrt(b*b-a*c))/a;
         if (temp < tmax && temp > tmin) {
-            rec.t = temp;
-            rec.p = r.point_at_parameter(rec.t);
-            rec.normal = (rec.p - center) / radius;
-            rec.mat_ptr = mat_ptr;
+            t = temp;
             return true;
         }
         temp = (-b + sqrt(b*b-a*c))/a;
         if (temp < tmax && temp > tmin) {
-            rec.t = temp;
-            rec.p = r.point_at_parameter(rec.t);
-            rec.normal = (rec.p - center) / radius;
-            rec.mat_ptr = mat_ptr;
+            t = temp;
             return true;
         }
     }
     return false;
 }
 
-vec3 random_in_unit_sphere(){
+// The ray/sphere test shared by sphere::hit and the batched sphere_soa, so
+// both report bit-identical hits.
+inline bool hit_sphere(const vec3& center, real radius, int mat_id,
+                       const ray& r, real tmin, real tmax, hit_record& rec) {
+    real t;
+    if (!sphere_root(center, radius, r, tmin, tmax, t))
+        return false;
+    rec.t = t;
+    rec.p = r.point_at_parameter(rec.t);
+    rec.normal = (rec.p - center) / radius;
+    rec.mat_id = mat_id;
+    rec.mapping = UV_SPHERE;
+    rec.uv_length = radius;
+    return true;
+}
+
+inline vec3 random_in_unit_sphere(){
     vec3 p;
     do{
         p = 2.0*vec3(random_double(), random_double(), random_double()) - vec3(1, 1, 1);
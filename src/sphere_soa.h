@@ -0,0 +1,245 @@
+#ifndef SPHERE_SOAH
+#define SPHERE_SOAH
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "aligned.h"
+#include "simd.h"
+#include "sphere.h"
+
+// Ray constants the batch kernels broadcast across SIMD lanes.
+struct sphere_cull_ray {
+    float ox, oy, oz;
+    float dx, dy, dz;
+    float a, inv_a, inv_sqrt_a;
+    float tmin, tmax;
+};
+
+// A batch kernel looks at up to 64 spheres starting at the given array
+// offsets and returns a bit per sphere that might be hit inside
+// [tmin, tmax]. It is only a conservative filter: the discriminant and the
+// range test both carry a little slack, and every candidate is then run
+// through the same hit_sphere() as sphere::hit. That keeps results
+// bit-identical to the scalar path no matter how the SIMD arithmetic rounds.
+typedef uint64_t (*sphere_cull_fn)(const float* cx, const float* cy, const float* cz,
+                                   const float* radius, int count, const sphere_cull_ray& q);
+
+inline uint64_t cull_spheres_scalar(const float* cx, const float* cy, const float* cz,
+                                    const float* radius, int count, const sphere_cull_ray& q) {
+    uint64_t mask = 0;
+    for (int k = 0; k < count; k++) {
+        float ocx = q.ox - cx[k], ocy = q.oy - cy[k], ocz = q.oz - cz[k];
+        float b = ocx*q.dx + ocy*q.dy + ocz*q.dz;
+        float c = ocx*ocx + ocy*ocy + ocz*ocz - radius[k]*radius[k];
+        float bb = b*b, ac = q.a*c;
+        float disc = bb - ac;
+        float tol = 1e-5f*(bb + std::fabs(ac));
+        // The chord lies within [tc - h, tc + h] around the closest approach.
+        float tc = -b*q.inv_a;
+        float h = radius[k]*q.inv_sqrt_a;
+        float slack = 1e-4f*(std::fabs(tc) + h);
+        if (disc > -tol && tc + h + slack > q.tmin && tc - h - slack < q.tmax)
+            mask |= uint64_t(1) << k;
+    }
+    return mask;
+}
+
+#ifdef SIMD_X86
+__attribute__((target("sse2")))
+inline uint64_t cull_spheres_sse(const float* cx, const float* cy, const float* cz,
+                                 const float* radius, int count, const sphere_cull_ray& q) {
+    const __m128 ox = _mm_set1_ps(q.ox), oy = _mm_set1_ps(q.oy), oz = _mm_set1_ps(q.oz);
+    const __m128 dx = _mm_set1_ps(q.dx), dy = _mm_set1_ps(q.dy), dz = _mm_set1_ps(q.dz);
+    const __m128 a = _mm_set1_ps(q.a), inv_a = _mm_set1_ps(q.inv_a);
+    const __m128 inv_sqrt_a = _mm_set1_ps(q.inv_sqrt_a);
+    const __m128 tmin = _mm_set1_ps(q.tmin), tmax = _mm_set1_ps(q.tmax);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 disc_eps = _mm_set1_ps(1e-5f), range_eps = _mm_set1_ps(1e-4f);
+
+    uint64_t mask = 0;
+    for (int k = 0; k < count; k += 4) {
+        __m128 r = _mm_load_ps(radius + k);
+        __m128 ocx = _mm_sub_ps(ox, _mm_load_ps(cx + k));
+        __m128 ocy = _mm_sub_ps(oy, _mm_load_ps(cy + k));
+        __m128 ocz = _mm_sub_ps(oz, _mm_load_ps(cz + k));
+        __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)),
+                                         _mm_mul_ps(ocz, ocz)), _mm_mul_ps(r, r));
+        __m128 bb = _mm_mul_ps(b, b), ac = _mm_mul_ps(a, c);
+        __m128 disc = _mm_sub_ps(bb, ac);
+        __m128 neg_tol = _mm_sub_ps(_mm_setzero_ps(),
+                                    _mm_mul_ps(disc_eps, _mm_add_ps(bb, _mm_and_ps(ac, abs_mask))));
+        __m128 tc = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(b, inv_a));
+        __m128 h = _mm_mul_ps(r, inv_sqrt_a);
+        __m128 reach = _mm_add_ps(h, _mm_mul_ps(range_eps, _mm_add_ps(_mm_and_ps(tc, abs_mask), h)));
+        __m128 m = _mm_and_ps(_mm_cmpgt_ps(disc, neg_tol),
+                   _mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(tc, reach), tmin),
+                              _mm_cmplt_ps(_mm_sub_ps(tc, reach), tmax)));
+        mask |= uint64_t(_mm_movemask_ps(m)) << k;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+inline uint64_t cull_spheres_avx2(const float* cx, const float* cy, const float* cz,
+                                  const float* radius, int count, const sphere_cull_ray& q) {
+    const __m256 ox = _mm256_set1_ps(q.ox), oy = _mm256_set1_ps(q.oy), oz = _mm256_set1_ps(q.oz);
+    const __m256 dx = _mm256_set1_ps(q.dx), dy = _mm256_set1_ps(q.dy), dz = _mm256_set1_ps(q.dz);
+    const __m256 a = _mm256_set1_ps(q.a), inv_a = _mm256_set1_ps(q.inv_a);
+    const __m256 inv_sqrt_a = _mm256_set1_ps(q.inv_sqrt_a);
+    const __m256 tmin = _mm256_set1_ps(q.tmin), tmax = _mm256_set1_ps(q.tmax);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 disc_eps = _mm256_set1_ps(1e-5f), range_eps = _mm256_set1_ps(1e-4f);
+
+    uint64_t mask = 0;
+    for (int k = 0; k < count; k += 8) {
+        __m256 r = _mm256_load_ps(radius + k);
+        __m256 ocx = _mm256_sub_ps(ox, _mm256_load_ps(cx + k));
+        __m256 ocy = _mm256_sub_ps(oy, _mm256_load_ps(cy + k));
+        __m256 ocz = _mm256_sub_ps(oz, _mm256_load_ps(cz + k));
+        __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, dx), _mm256_mul_ps(ocy, dy)),
+                                 _mm256_mul_ps(ocz, dz));
+        __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)),
+                                               _mm256_mul_ps(ocz, ocz)), _mm256_mul_ps(r, r));
+        __m256 bb = _mm256_mul_ps(b, b), ac = _mm256_mul_ps(a, c);
+        __m256 disc = _mm256_sub_ps(bb, ac);
+        __m256 neg_tol = _mm256_sub_ps(_mm256_setzero_ps(),
+                                       _mm256_mul_ps(disc_eps, _mm256_add_ps(bb, _mm256_and_ps(ac, abs_mask))));
+        __m256 tc = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(b, inv_a));
+        __m256 h = _mm256_mul_ps(r, inv_sqrt_a);
+        __m256 reach = _mm256_add_ps(h, _mm256_mul_ps(range_eps, _mm256_add_ps(_mm256_and_ps(tc, abs_mask), h)));
+        __m256 m = _mm256_and_ps(_mm256_cmp_ps(disc, neg_tol, _CMP_GT_OQ),
+                   _mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(tc, reach), tmin, _CMP_GT_OQ),
+                                 _mm256_cmp_ps(_mm256_sub_ps(tc, reach), tmax, _CMP_LT_OQ)));
+        mask |= uint64_t(_mm256_movemask_ps(m)) << k;
+    }
+    return mask;
+}
+
+__attribute__((target("avx512f")))
+inline uint64_t cull_spheres_avx512(const float* cx, const float* cy, const float* cz,
+                                    const float* radius, int count, const sphere_cull_ray& q) {
+    const __m512 ox = _mm512_set1_ps(q.ox), oy = _mm512_set1_ps(q.oy), oz = _mm512_set1_ps(q.oz);
+    const __m512 dx = _mm512_set1_ps(q.dx), dy = _mm512_set1_ps(q.dy), dz = _mm512_set1_ps(q.dz);
+    const __m512 a = _mm512_set1_ps(q.a), inv_a = _mm512_set1_ps(q.inv_a);
+    const __m512 inv_sqrt_a = _mm512_set1_ps(q.inv_sqrt_a);
+    const __m512 tmin = _mm512_set1_ps(q.tmin), tmax = _mm512_set1_ps(q.tmax);
+    const __m512 disc_eps = _mm512_set1_ps(1e-5f), range_eps = _mm512_set1_ps(1e-4f);
+
+    uint64_t mask = 0;
+    for (int k = 0; k < count; k += 16) {
+        __m512 r = _mm512_load_ps(radius + k);
+        __m512 ocx = _mm512_sub_ps(ox, _mm512_load_ps(cx + k));
+        __m512 ocy = _mm512_sub_ps(oy, _mm512_load_ps(cy + k));
+        __m512 ocz = _mm512_sub_ps(oz, _mm512_load_ps(cz + k));
+        __m512 b = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ocx, dx), _mm512_mul_ps(ocy, dy)),
+                                 _mm512_mul_ps(ocz, dz));
+        __m512 c = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ocx, ocx), _mm512_mul_ps(ocy, ocy)),
+                                               _mm512_mul_ps(ocz, ocz)), _mm512_mul_ps(r, r));
+        __m512 bb = _mm512_mul_ps(b, b), ac = _mm512_mul_ps(a, c);
+        __m512 disc = _mm512_sub_ps(bb, ac);
+        __m512 neg_tol = _mm512_sub_ps(_mm512_setzero_ps(),
+                                       _mm512_mul_ps(disc_eps, _mm512_add_ps(bb, _mm512_abs_ps(ac))));
+        __m512 tc = _mm512_sub_ps(_mm512_setzero_ps(), _mm512_mul_ps(b, inv_a));
+        __m512 h = _mm512_mul_ps(r, inv_sqrt_a);
+        __m512 reach = _mm512_add_ps(h, _mm512_mul_ps(range_eps, _mm512_add_ps(_mm512_abs_ps(tc), h)));
+        __mmask16 m = _mm512_cmp_ps_mask(disc, neg_tol, _CMP_GT_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, _mm512_add_ps(tc, reach), tmin, _CMP_GT_OQ);
+        m = _mm512_mask_cmp_ps_mask(m, _mm512_sub_ps(tc, reach), tmax, _CMP_LT_OQ);
+        mask |= uint64_t(m) << k;
+    }
+    return mask;
+}
+#endif
+
+// Returns the kernel for the given level, falling back to the widest one
+// that was compiled in.
+inline sphere_cull_fn sphere_cull_kernel(simd_level level) {
+#ifdef SIMD_X86
+    switch (level) {
+        case simd_avx512: return cull_spheres_avx512;
+        case simd_avx2:   return cull_spheres_avx2;
+        case simd_sse:    return cull_spheres_sse;
+        default:          break;
+    }
+#endif
+    return cull_spheres_scalar;
+}
+
+// A group of spheres stored as separate aligned arrays of centre
+// coordinates and radii. hit() tests one ray against 4, 8 or 16 spheres per
+// instruction and returns exactly what a hitable_list of the same spheres,
+// in the same order, would. The arrays are float in any build, so with
+// REAL_DOUBLE centres and radii are rounded to float when added.
+class sphere_soa : public hitable {
+    public:
+        sphere_soa() {}
+
+        void add(const vec3& center, float radius, int m) {
+            int i = size();
+            if (i == int(cx.size())) {
+                // Grow a whole block at a time, padding with NaN centres that
+                // fail every comparison in the kernels.
+                float nan = std::numeric_limits<float>::quiet_NaN();
+                cx.resize(i + block_size, nan);
+                cy.resize(i + block_size, nan);
+                cz.resize(i + block_size, nan);
+                radii.resize(i + block_size, 0);
+            }
+            cx[i] = center[0];
+            cy[i] = center[1];
+            cz[i] = center[2];
+            radii[i] = radius;
+            mats.push_back(m);
+            vec3 rvec(radius, radius, radius);
+            bbox = aabb(bbox, aabb(center - rvec, center + rvec));
+        }
+
+        int size() const { return mats.size(); }
+
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            vec3 o = r.origin(), d = r.direction();
+            sphere_cull_ray q;
+            q.ox = o[0]; q.oy = o[1]; q.oz = o[2];
+            q.dx = d[0]; q.dy = d[1]; q.dz = d[2];
+            q.a = dot(d, d);
+            q.inv_a = 1.0f / q.a;
+            q.inv_sqrt_a = 1.0f / std::sqrt(q.a);
+            q.tmin = tmin;
+
+            bool hit_anything = false;
+            real closest_so_far = tmax;
+            int n = size();
+            for (int block = 0; block < n; block += block_size) {
+                int count = n - block < block_size ? n - block : block_size;
+                q.tmax = closest_so_far;
+                uint64_t mask = kernel(&cx[block], &cy[block], &cz[block], &radii[block], count, q);
+                while (mask) {
+                    int i = block + __builtin_ctzll(mask);
+                    mask &= mask - 1;
+                    if (hit_sphere(vec3(cx[i], cy[i], cz[i]), radii[i], mats[i], r, tmin, closest_so_far, rec)) {
+                        hit_anything = true;
+                        closest_so_far = rec.t;
+                    }
+                }
+            }
+            return hit_anything;
+        }
+
+        virtual aabb bounding_box() const { return bbox; }
+
+        // The batch kernel used by hit(), picked once from the CPU's features.
+        // Benchmarks may switch it to compare instruction sets.
+        inline static sphere_cull_fn kernel = sphere_cull_kernel(cpu_simd_level());
+
+    private:
+        static const int block_size = 64;
+
+        aligned_vector<float> cx, cy, cz, radii;
+        std::vector<int> mats;
+        aabb bbox;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include "camera.h"
 #include <math.h>
 #include "perlin.h"
+#include "image.h"
 using namespace std;
 
 bool hit_sphere(const vec3& center, float radius, const ray& r){
@@ -29,12 +30,12 @@ float hit_sphere_at_t(const vec3& center, float radius, const ray& r){
     }
 }
 
-vec3 perlin_noise_color(const vec3& p, const PerlinNoise& noise_generator) {
+vec3 perlin_noise_color(const vec3& p, const perlin& noise_generator) {
     // Generate Perlin noise values for RGB channels using input coordinates
     
-    float r = noise_generator.noise(p.x() * 0.1, p.y() * 0.1, p.z() * 0.1); // Scale down coordinates
-    float g = noise_generator.noise(p.x() * 0.1 + 1, p.y() * 0.1, p.z() * 0.1); // Offset for different color channels
-    float b = noise_generator.noise(p.x() * 0.1, p.y() * 0.1 + 1, p.z() * 0.1); // Offset for different color channels
+    float r = noise_generator.noise(vec3(p.x() * 0.1, p.y() * 0.1, p.z() * 0.1)); // Scale down coordinates
+    float g = noise_generator.noise(vec3(p.x() * 0.1 + 1, p.y() * 0.1, p.z() * 0.1)); // Offset for different color channels
+    float b = noise_generator.noise(vec3(p.x() * 0.1, p.y() * 0.1 + 1, p.z() * 0.1)); // Offset for different color channels
 
     // Scale and clamp values to ensure they are within valid color range (0-1)
     r = 1 / (1 + exp(-r));
@@ -45,9 +46,10 @@ vec3 perlin_noise_color(const vec3& p, const PerlinNoise& noise_generator) {
 }
 
 vec3 color(const ray& r) {
+        static const perlin noise_generator;
         float t = hit_sphere_at_t(vec3(0,0,-1), 0.5, r);
         if (t > 0.0) {
-            vec3 N = perlin_noise_color(r.point_at_parameter(t), PerlinNoise());
+            vec3 N = perlin_noise_color(r.point_at_parameter(t), noise_generator);
             return N;
         }
         vec3 unit_direction = unit_vector(r.direction());
@@ -60,9 +62,7 @@ int main(){
     int nx = 2000;
     int ny = 1000;
 
-    ofstream myfile;
-    myfile.open ("image.ppm");int ns = 10;
-    myfile << "P3\n" << nx << " " << ny << "\n255\n";
+    image img(nx, ny);
     camera cam(vec3(-1, 0, 1), vec3(0,0,-1), vec3(0,1,0), 45, float(nx)/float(ny));
     for(int j = ny-1; j>=0; j--){
         for(int i=0; i<nx; i++){
@@ -70,11 +70,8 @@ int main(){
             float v = float(j) / float(ny);
             ray r = cam.get_ray(u, v);
             vec3 col = color(r);
-            int ir = int(255.99*col[0]);
-            int ig = int(255.99*col[1]);
-            int ib = int(255.99*col[2]);
-            myfile << ir << " " << ig << " " << ib << "\n";
+            img.at(i, j) = col;
         }
     }
-    myfile.close();
+    write_image("image.ppm", img, false);
 }
\ No newline at end of file
@@ -1,32 +1,57 @@
+#ifndef TEXTUREH
+#define TEXTUREH
+
 #include "vec3.h"
 #include "perlin.h"
-#include "color.h"
+#include "texture_cache.h"
 
+// A colour over a surface. footprint is the width of the area the lookup
+// stands for, in (u, v) units, for textures that filter; 0 is one point.
+// Colours are vec3 rather than color.h's alias, which would hide the
+// integrator's color().
 class texture {
   public:
     virtual ~texture() = default;
 
-    virtual color value(double u, double v, const vec3& p) const = 0;
+    virtual vec3 value(real u, real v, const vec3& p, real footprint) const = 0;
 };
 
 class constant_texture : public texture {
     public:
         constant_texture() { }
-        constant_texture(vec3 c) : color(c) { }
-        virtual vec3 value(float u, float v, const vec3& p) const {
-            return color;
+        constant_texture(vec3 c) : color_value(c) { }
+        vec3 value(real u, real v, const vec3& p, real footprint) const override {
+            return color_value;
         }
-        vec3 color;
+        vec3 color_value;
 };
 
 class noise_texture : public texture {
   public:
     noise_texture() {}
+    noise_texture(double scale) : scale(scale) {}
 
-    color value(double u, double v, const vec3& p) const override {
-        return color(1,1,1) * noise.noise(p);
+    vec3 value(real u, real v, const vec3& p, real footprint) const override {
+        return vec3(1,1,1) * 0.5 * (1 + noise.noise(scale * p));
     }
 
   private:
     perlin noise;
-};
\ No newline at end of file
+    double scale = 1;
+};
+
+// An image held in a texture_cache, mip-mapped over the footprint.
+class image_texture : public texture {
+  public:
+    image_texture(texture_cache* cache, int id) : cache(cache), id(id) {}
+
+    vec3 value(real u, real v, const vec3& p, real footprint) const override {
+        return cache->sample(id, u, v, footprint);
+    }
+
+  private:
+    texture_cache* cache;
+    int id;
+};
+
+#endif
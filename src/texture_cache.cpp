@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "image.h"
+#include "texture_cache.h"
+
+namespace {
+
+// Linear values of the gamma 2 encoded samples.
+const std::array<float, 256>& linear_table() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> t;
+        for (int k = 0; k < 256; k++)
+            t[k] = float(k*k) / (255.0f*255.0f);
+        return t;
+    }();
+    return table;
+}
+
+uint8_t encode(float linear) {
+    return uint8_t(std::min(255.0f, std::sqrt(linear) * 255.0f + 0.5f));
+}
+
+// The next mip level of an RGB level: each texel averages the 2x2 block
+// above it in linear space. An odd last row or column is folded into the
+// blocks before it.
+std::vector<uint8_t> downsample(const std::vector<uint8_t>& src, int width, int height, int& out_width,
+                                int& out_height) {
+    const std::array<float, 256>& linear = linear_table();
+    out_width = std::max(1, width / 2);
+    out_height = std::max(1, height / 2);
+    std::vector<uint8_t> dst(size_t(out_width) * out_height * 3);
+    for (int y = 0; y < out_height; y++) {
+        int y0 = 2*y, y1 = std::min(height, y == out_height - 1 ? height : 2*y + 2);
+        for (int x = 0; x < out_width; x++) {
+            int x0 = 2*x, x1 = std::min(width, x == out_width - 1 ? width : 2*x + 2);
+            float sum[3] = { 0, 0, 0 };
+            for (int sy = y0; sy < y1; sy++)
+                for (int sx = x0; sx < x1; sx++)
+                    for (int c = 0; c < 3; c++)
+                        sum[c] += linear[src[(size_t(sy)*width + sx)*3 + c]];
+            float n = float((y1 - y0) * (x1 - x0));
+            for (int c = 0; c < 3; c++)
+                dst[(size_t(y)*out_width + x)*3 + c] = encode(sum[c] / n);
+        }
+    }
+    return dst;
+}
+
+}
+
+texture_cache::texture_cache(size_t budget)
+    : scratch(-1), tile_count(0), shards(new shard[shard_count]) {
+    set_budget(budget);
+}
+
+texture_cache::~texture_cache() {
+    if (scratch >= 0)
+        close(scratch);
+}
+
+int texture_cache::add(const std::string& path, std::string& error) {
+    std::vector<uint8_t> rgb;
+    int width, height;
+    if (!read_image(path, rgb, width, height, error))
+        return -1;
+    return add(rgb.data(), width, height, error);
+}
+
+int texture_cache::add(const uint8_t* rgb, int width, int height, std::string& error) {
+    if (width <= 0 || height <= 0) {
+        error = "texture has no pixels";
+        return -1;
+    }
+    if (scratch < 0) {
+        const char* dir = getenv("TMPDIR");
+        std::string name = std::string(dir && *dir ? dir : "/var/tmp") + "/texture-cache-XXXXXX";
+        scratch = mkstemp(&name[0]);
+        if (scratch < 0) {
+            error = "could not create a texture scratch file in " + name.substr(0, name.rfind('/'));
+            return -1;
+        }
+        unlink(name.c_str());
+    }
+
+    // Level 0 is the image flipped so row 0 is the bottom, as v runs.
+    std::vector<uint8_t> pixels(size_t(width) * height * 3);
+    for (int y = 0; y < height; y++)
+        memcpy(&pixels[size_t(y) * width * 3], rgb + size_t(height - 1 - y) * width * 3, size_t(width) * 3);
+
+    texture_levels t;
+    std::vector<uint8_t> tile(tile_bytes);
+    while (true) {
+        level l;
+        l.width = width;
+        l.height = height;
+        l.tiles_x = (width + tile_size - 1) / tile_size;
+        l.first_tile = tile_count;
+        int tiles_y = (height + tile_size - 1) / tile_size;
+        for (int ty = 0; ty < tiles_y; ty++) {
+            for (int tx = 0; tx < l.tiles_x; tx++) {
+                // Texels past the edge repeat the last ones; lookups wrap
+                // before reaching them.
+                uint8_t* out = tile.data();
+                for (int y = 0; y < tile_size; y++) {
+                    int sy = std::min(height - 1, ty*tile_size + y);
+                    for (int x = 0; x < tile_size; x++) {
+                        int sx = std::min(width - 1, tx*tile_size + x);
+                        memcpy(out, &pixels[(size_t(sy)*width + sx)*3], 3);
+                        out[3] = 255;
+                        out += 4;
+                    }
+                }
+                if (pwrite(scratch, tile.data(), tile_bytes, off_t(tile_count) * tile_bytes) != ssize_t(tile_bytes)) {
+                    error = "could not write the texture scratch file";
+                    return -1;
+                }
+                tile_count++;
+            }
+        }
+        tile_slots.resize(tile_count, -1);
+        t.levels.push_back(l);
+        if (width == 1 && height == 1)
+            break;
+        pixels = downsample(pixels, width, height, width, height);
+    }
+    textures.push_back(std::move(t));
+    return int(textures.size()) - 1;
+}
+
+void texture_cache::set_budget(size_t bytes) {
+    shard_slots = int(std::max(size_t(1), bytes / tile_bytes / shard_count));
+    for (int k = 0; k < shard_count; k++) {
+        shard& s = shards[k];
+        // Allocated on the first miss; untouched slots cost no memory anyway.
+        s.slots.reset();
+        s.slot_keys.assign(shard_slots, 0);
+        s.prev.assign(shard_slots, -1);
+        s.next.assign(shard_slots, -1);
+        s.head = s.tail = -1;
+        s.used = 0;
+    }
+    tile_slots.assign(tile_count, -1);
+}
+
+size_t texture_cache::resident_bytes() const {
+    size_t used = 0;
+    for (int k = 0; k < shard_count; k++) {
+        std::lock_guard<std::mutex> guard(shards[k].lock);
+        used += shards[k].used;
+    }
+    return used * tile_bytes;
+}
+
+texture_cache::counters texture_cache::stats() const {
+    counters total;
+    for (int k = 0; k < shard_count; k++) {
+        std::lock_guard<std::mutex> guard(shards[k].lock);
+        total.hits += shards[k].counts.hits;
+        total.misses += shards[k].counts.misses;
+        total.evictions += shards[k].counts.evictions;
+    }
+    return total;
+}
+
+void texture_cache::reset_stats() {
+    for (int k = 0; k < shard_count; k++) {
+        std::lock_guard<std::mutex> guard(shards[k].lock);
+        shards[k].counts = counters();
+    }
+}
+
+void texture_cache::shard::unlink_slot(int slot) {
+    if (prev[slot] >= 0) next[prev[slot]] = next[slot]; else head = next[slot];
+    if (next[slot] >= 0) prev[next[slot]] = prev[slot]; else tail = prev[slot];
+}
+
+// Puts slot at the front of the list.
+void texture_cache::shard::touch(int slot) {
+    prev[slot] = -1;
+    next[slot] = head;
+    if (head >= 0)
+        prev[head] = slot;
+    head = slot;
+    if (tail < 0)
+        tail = slot;
+}
+
+// The tile with the given index in the scratch file, read into s if it
+// isn't resident. s must be the tile's shard, locked.
+const uint8_t* texture_cache::load_tile(shard& s, uint64_t key) {
+    int slot = tile_slots[key];
+    if (slot >= 0) {
+        s.counts.hits++;
+        if (slot != s.head) {
+            s.unlink_slot(slot);
+            s.touch(slot);
+        }
+        return &s.slots[size_t(slot) * tile_bytes];
+    }
+
+    s.counts.misses++;
+    if (!s.slots)
+        s.slots.reset(new uint8_t[size_t(shard_slots) * tile_bytes]);
+    if (s.used < shard_slots) {
+        slot = s.used++;
+    } else {
+        slot = s.tail;
+        s.unlink_slot(slot);
+        tile_slots[s.slot_keys[slot]] = -1;
+        s.counts.evictions++;
+    }
+    uint8_t* data = &s.slots[size_t(slot) * tile_bytes];
+    ssize_t n = pread(scratch, data, tile_bytes, off_t(key) * tile_bytes);
+    if (n != ssize_t(tile_bytes))
+        memset(data, 0, tile_bytes);
+    s.slot_keys[slot] = key;
+    tile_slots[key] = slot;
+    s.touch(slot);
+    return data;
+}
+
+// Copies count texels of tile key, at the given byte offsets in it, to out
+// under one lock of the tile's shard.
+void texture_cache::copy_texels(uint64_t key, const int* offsets, int count, uint8_t (*out)[4]) {
+    shard& s = shards[shard_of(key)];
+    std::lock_guard<std::mutex> guard(s.lock);
+    const uint8_t* data = load_tile(s, key);
+    for (int k = 0; k < count; k++)
+        memcpy(out[k], data + offsets[k], 4);
+}
+
+// Bilinear filtering between the four texels around (u, v), wrapping at
+// the edges. u and v are in [0, 1].
+vec3 texture_cache::bilinear(const level& l, real u, real v) {
+    real x = u * l.width - real(0.5), y = v * l.height - real(0.5);
+    real fx = std::floor(x), fy = std::floor(y);
+    real sx = x - fx, sy = y - fy;
+    int x0 = int(fx), y0 = int(fy);
+    if (x0 < 0) x0 += l.width;
+    if (y0 < 0) y0 += l.height;
+    if (x0 >= l.width) x0 -= l.width;
+    if (y0 >= l.height) y0 -= l.height;
+    auto key = [&](int x, int y) { return l.first_tile + uint64_t(y / tile_size) * l.tiles_x + x / tile_size; };
+    auto offset = [](int x, int y) { return ((y % tile_size) * tile_size + x % tile_size) * 4; };
+    uint8_t t[4][4];  // (x0, y0), (x1, y0), (x0, y1), (x1, y1)
+    if (x0 % tile_size != tile_size - 1 && y0 % tile_size != tile_size - 1 && x0 + 1 < l.width && y0 + 1 < l.height) {
+        // All four in one tile, which is most of the time.
+        int o = offset(x0, y0);
+        int offsets[4] = { o, o + 4, o + tile_size*4, o + tile_size*4 + 4 };
+        copy_texels(key(x0, y0), offsets, 4, t);
+    } else {
+        int x1 = x0 + 1 == l.width ? 0 : x0 + 1;
+        int y1 = y0 + 1 == l.height ? 0 : y0 + 1;
+        int xs[4] = { x0, x1, x0, x1 }, ys[4] = { y0, y0, y1, y1 };
+        for (int k = 0; k < 4; k++) {
+            int o = offset(xs[k], ys[k]);
+            copy_texels(key(xs[k], ys[k]), &o, 1, &t[k]);
+        }
+    }
+    const std::array<float, 256>& linear = linear_table();
+    real w00 = (1 - sx)*(1 - sy), w10 = sx*(1 - sy), w01 = (1 - sx)*sy, w11 = sx*sy;
+    vec3 c;
+    for (int k = 0; k < 3; k++)
+        c[k] = w00*linear[t[0][k]] + w10*linear[t[1][k]] + w01*linear[t[2][k]] + w11*linear[t[3][k]];
+    return c;
+}
+
+vec3 texture_cache::sample(int id, real u, real v, real footprint) {
+    const std::vector<level>& levels = textures[id].levels;
+    u -= std::floor(u);
+    v -= std::floor(v);
+    int last = int(levels.size()) - 1;
+    // footprint is in (u, v) units measured like uv_length, as a geometric
+    // mean, so it spans footprint * sqrt(width * height) texels.
+    real lod = 0;
+    if (footprint > 0)
+        lod = std::log2(footprint * std::sqrt(real(levels[0].width) * levels[0].height));
+    lod = std::min(std::max(lod, real(0)), real(last));
+    int l0 = int(lod);
+    real f = lod - l0;
+
+    vec3 c = bilinear(levels[l0], u, v);
+    if (f > 0 && l0 < last)
+        c = (1 - f)*c + f*bilinear(levels[l0 + 1], u, v);
+    return c;
+}
@@ -0,0 +1,129 @@
+#ifndef TEXTURE_CACHEH
+#define TEXTURE_CACHEH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "vec3.h"
+
+// Image textures held in a fixed amount of memory, however many and however
+// large they are.
+//
+// add() decodes an image once, builds its mip levels down to 1x1 and writes
+// them to an unlinked scratch file as tiles of 32x32 texels, then drops the
+// decoded image. Only tiles live in memory: a fixed number of slots, as
+// many as fit in the budget, with the least recently used tile evicted on
+// a miss. Lookups touch at most two levels of a few tiles each, so a
+// renderer working through the image tile by tile keeps hitting the same
+// handful of texture tiles.
+//
+// Tiles hold 8 bit RGBA, gamma 2 encoded like the images we write, so each
+// is 4 KiB, one page of the scratch file. Alpha is unused. sample() returns
+// linear colour. Besides the budget, the cache keeps 4 bytes per stored
+// tile to find resident ones, a thousandth of the textures' size.
+//
+// The slots are split into shards, each with its own mutex and LRU list,
+// and a tile belongs to the shard its index hashes to, so threads looking
+// up different tiles rarely wait on each other. A lookup copies its texels
+// out under the shard's lock, as another thread may evict the tile as soon
+// as it is released; it usually takes one lock per mip level. add() and
+// set_budget() are not safe alongside lookups, so they come first.
+class texture_cache {
+    public:
+        static const int tile_size = 32;
+        static const size_t tile_bytes = tile_size * tile_size * 4;
+        // Shards of the slots; a power of two. Each keeps at least one tile
+        // whatever the budget.
+        static const int shard_bits = 6;
+        static const int shard_count = 1 << shard_bits;
+
+        struct counters {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+        };
+
+        // budget is in bytes of tile memory. The scratch file goes in
+        // $TMPDIR, or /var/tmp, which unlike /tmp is rarely backed by RAM.
+        explicit texture_cache(size_t budget = size_t(64) << 20);
+        ~texture_cache();
+        texture_cache(const texture_cache&) = delete;
+        texture_cache& operator=(const texture_cache&) = delete;
+
+        // Reads a PPM or PNG file and returns the texture's id. On failure
+        // returns -1 with the reason in error.
+        int add(const std::string& path, std::string& error);
+        // The same for 8 bit RGB samples in memory, top row first. Fails
+        // if width or height isn't positive.
+        int add(const uint8_t* rgb, int width, int height, std::string& error);
+
+        // The linear colour of texture id at (u, v), with (0, 0) the bottom
+        // left corner and the image repeating outside [0, 1). footprint is
+        // the width of the area to average over in the same units; it picks
+        // the pair of mip levels to blend, so 0 reads the full resolution.
+        vec3 sample(int id, real u, real v, real footprint);
+
+        // Empties the cache and resizes it to hold budget bytes of tiles.
+        void set_budget(size_t bytes);
+        size_t budget() const { return size_t(shard_slots) * shard_count * tile_bytes; }
+        // Bytes of tiles loaded now, never more than budget().
+        size_t resident_bytes() const;
+        // Bytes of tiles in the scratch file, over all textures and levels.
+        size_t stored_bytes() const { return size_t(tile_count) * tile_bytes; }
+
+        int texture_count() const { return int(textures.size()); }
+        int width(int id) const { return textures[id].levels[0].width; }
+        int height(int id) const { return textures[id].levels[0].height; }
+        int level_count(int id) const { return int(textures[id].levels.size()); }
+
+        counters stats() const;
+        void reset_stats();
+
+    private:
+        struct level {
+            int width, height;
+            int tiles_x;
+            uint64_t first_tile;  // index in the scratch file
+        };
+
+        struct texture_levels {
+            std::vector<level> levels;
+        };
+
+        // shard_slots slots of tiles, on a cache line of their own.
+        struct alignas(64) shard {
+            std::mutex lock;
+            std::unique_ptr<uint8_t[]> slots;
+            std::vector<uint64_t> slot_keys;
+            // The slots in use as a list, most recently used first.
+            std::vector<int> prev, next;
+            int head, tail;
+            int used;
+            counters counts;
+
+            void touch(int slot);
+            void unlink_slot(int slot);
+        };
+
+        static int shard_of(uint64_t key) {
+            return int((key * 0x9e3779b97f4a7c15ull) >> (64 - shard_bits));
+        }
+        const uint8_t* load_tile(shard& s, uint64_t key);
+        void copy_texels(uint64_t key, const int* offsets, int count, uint8_t (*out)[4]);
+        vec3 bilinear(const level& l, real u, real v);
+
+        std::vector<texture_levels> textures;
+        int scratch;  // file descriptor
+        uint64_t tile_count;
+
+        int shard_slots;
+        std::unique_ptr<shard[]> shards;  // shard_count of them
+        // By tile index, the tile's slot in its shard or -1 if not
+        // resident. Each entry is guarded by its tile's shard.
+        std::vector<int32_t> tile_slots;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef TILE_RENDERERH
+#define TILE_RENDERERH
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "vec3.h"
+#include "path_stats.h"
+#include "random.h"
+
+struct tile {
+    int x0, y0, x1, y1;
+};
+
+// One queue per worker. The owner pops tiles from the front, idle workers
+// steal from the back so they pick up the work the owner would reach last.
+struct tile_queue {
+    std::deque<tile> tiles;
+    std::mutex lock;
+};
+
+// The calling thread works as worker 0 and nthreads - 1 pool threads, started
+// once in the constructor, join it for each job, so renders made of many
+// passes don't pay for thread startup every pass.
+class tile_renderer {
+    public:
+        tile_renderer(int nx, int ny, int tile_size = 16, int nthreads = 0)
+            : nx(nx), ny(ny), tile_size(tile_size), nthreads(nthreads) {
+            if (this->nthreads <= 0)
+                this->nthreads = std::thread::hardware_concurrency();
+            if (this->nthreads <= 0)
+                this->nthreads = 1;
+            for (int id = 1; id < this->nthreads; id++)
+                workers.emplace_back([this, id] { work(id); });
+        }
+
+        ~tile_renderer() {
+            {
+                std::lock_guard<std::mutex> guard(pool_lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& th : workers)
+                th.join();
+        }
+
+        tile_renderer(const tile_renderer&) = delete;
+        tile_renderer& operator=(const tile_renderer&) = delete;
+
+        // Calls shade(i, j) once for every pixel and stores the result in
+        // framebuffer[j*nx + i]. The RNG is reseeded from (seed, i, j) before
+        // each pixel, so the image is the same for any thread count.
+        template <typename Shader>
+        void render(Shader shade, std::vector<vec3>& framebuffer, uint64_t seed) const {
+            framebuffer.assign(nx*ny, vec3(0, 0, 0));
+            render_tiles([&](const tile& t) {
+                for (int j = t.y0; j < t.y1; j++) {
+                    for (int i = t.x0; i < t.x1; i++) {
+                        seed_random(pixel_seed(seed, i, j));
+                        framebuffer[j*nx + i] = shade(i, j);
+                    }
+                }
+            });
+        }
+
+        // Calls shade_tile(t) once for every tile, spread over the pool, and
+        // returns when all are done. For shaders that want a whole tile of
+        // work at once. Not reentrant: shade_tile must not render.
+        template <typename TileShader>
+        void render_tiles(TileShader shade_tile) const {
+            std::vector<tile_queue> queues(nthreads);
+            int n = 0;
+            for (int y = 0; y < ny; y += tile_size) {
+                for (int x = 0; x < nx; x += tile_size) {
+                    tile t = { x, y, std::min(x + tile_size, nx), std::min(y + tile_size, ny) };
+                    queues[n++ % nthreads].tiles.push_back(t);
+                }
+            }
+
+            // Pool threads outlive the job, so each hands over its path
+            // counts at the end for collect_path_stats() to see.
+            std::function<void(int)> worker = [&](int id) {
+                tile t;
+                while (next_tile(queues, id, t))
+                    shade_tile(t);
+                flush_thread_path_stats();
+            };
+
+            {
+                std::lock_guard<std::mutex> guard(pool_lock);
+                job = &worker;
+                busy = int(workers.size());
+                generation++;
+            }
+            wake.notify_all();
+            worker(0);
+            std::unique_lock<std::mutex> guard(pool_lock);
+            done.wait(guard, [this] { return busy == 0; });
+            job = nullptr;
+        }
+
+        int nx, ny;
+        int tile_size;
+        int nthreads;
+
+    private:
+        // A pool thread: runs each job once as worker id, then waits for the
+        // next until the renderer is destroyed.
+        void work(int id) {
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> guard(pool_lock);
+            while (true) {
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                const std::function<void(int)>* f = job;
+                guard.unlock();
+                (*f)(id);
+                guard.lock();
+                if (--busy == 0)
+                    done.notify_one();
+            }
+        }
+
+        static bool next_tile(std::vector<tile_queue>& queues, int id, tile& t) {
+            {
+                std::lock_guard<std::mutex> guard(queues[id].lock);
+                if (!queues[id].tiles.empty()) {
+                    t = queues[id].tiles.front();
+                    queues[id].tiles.pop_front();
+                    return true;
+                }
+            }
+            // Own queue is drained, try to steal from the others.
+            int n = queues.size();
+            for (int k = 1; k < n; k++) {
+                tile_queue& victim = queues[(id + k) % n];
+                std::lock_guard<std::mutex> guard(victim.lock);
+                if (!victim.tiles.empty()) {
+                    t = victim.tiles.back();
+                    victim.tiles.pop_back();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::vector<std::thread> workers;
+        mutable std::mutex pool_lock;
+        mutable std::condition_variable wake, done;
+        // The job being rendered and its number; workers still in it.
+        mutable const std::function<void(int)>* job = nullptr;
+        mutable uint64_t generation = 0;
+        mutable int busy = 0;
+        bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include "triangle_mesh.h"
+
+namespace {
+
+// Parses one OBJ line at a time out of whatever the caller streams in.
+// Only v and f lines matter; everything else, vt and vn included, is
+// skipped without being looked at.
+class obj_parser {
+    public:
+        std::vector<vec3> vertices;
+        std::vector<int32_t> indices;
+        std::string message;
+
+        bool line(const char* p, const char* end) {
+            p = skip_space(p, end);
+            if (end - p < 2 || (p[1] != ' ' && p[1] != '\t'))
+                return true;
+            if (p[0] == 'v')
+                return vertex(p + 2, end);
+            if (p[0] == 'f')
+                return face(p + 2, end);
+            return true;
+        }
+
+    private:
+        std::vector<int32_t> corners;
+
+        static const char* skip_space(const char* p, const char* end) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+                p++;
+            return p;
+        }
+
+        bool fail(const std::string& m) {
+            message = m;
+            return false;
+        }
+
+        // v x y z [w]
+        bool vertex(const char* p, const char* end) {
+            float xyz[3];
+            for (int k = 0; k < 3; k++) {
+                p = skip_space(p, end);
+                if (p < end && *p == '+')
+                    p++;
+                std::from_chars_result r = std::from_chars(p, end, xyz[k]);
+                if (r.ec != std::errc())
+                    return fail("expected three numbers after v");
+                p = r.ptr;
+            }
+            vertices.push_back(vec3(xyz[0], xyz[1], xyz[2]));
+            return true;
+        }
+
+        // f v1[/vt1[/vn1]] v2... with at least three corners. Negative
+        // indices count back from the last vertex read so far.
+        bool face(const char* p, const char* end) {
+            corners.clear();
+            while ((p = skip_space(p, end)) < end && *p != '#') {
+                long long index;
+                std::from_chars_result r = std::from_chars(p, end, index);
+                if (r.ec != std::errc())
+                    return fail("bad face corner");
+                long long n = vertices.size();
+                if (index < 0)
+                    index += n;
+                else
+                    index -= 1;
+                if (index < 0 || index >= n)
+                    return fail("vertex index out of range");
+                corners.push_back(int32_t(index));
+                p = r.ptr;
+                while (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+                    p++;
+            }
+            if (corners.size() < 3)
+                return fail("face with fewer than three corners");
+            for (size_t k = 2; k < corners.size(); k++) {
+                indices.push_back(corners[0]);
+                indices.push_back(corners[k - 1]);
+                indices.push_back(corners[k]);
+            }
+            return true;
+        }
+};
+
+}
+
+bool read_obj(const std::string& path, std::vector<vec3>& vertices, std::vector<int32_t>& indices,
+              std::string& error) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        error = "can't open " + path;
+        return false;
+    }
+
+    // Lines are cut out of a fixed buffer; a partial line at the end of
+    // one read is moved to the front before the next.
+    const size_t buffer_size = 1 << 20;
+    std::vector<char> buffer(buffer_size);
+    obj_parser parser;
+    size_t kept = 0;
+    int line = 1;
+    bool ok = true;
+    while (ok) {
+        size_t n = fread(buffer.data() + kept, 1, buffer_size - kept, f);
+        bool eof = n == 0;
+        const char* p = buffer.data();
+        const char* end = p + kept + n;
+        while (ok) {
+            const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (!eol) {
+                if (!eof)
+                    break;
+                eol = end;
+            }
+            ok = parser.line(p, eol);
+            if (ok)
+                line++;
+            p = eol + 1;
+            if (p >= end)
+                break;
+        }
+        if (eof)
+            break;
+        kept = p < end ? end - p : 0;
+        if (kept == buffer_size) {
+            parser.message = "line longer than " + std::to_string(buffer_size) + " bytes";
+            ok = false;
+            break;
+        }
+        memmove(buffer.data(), p, kept);
+    }
+    bool read_error = ferror(f);
+    fclose(f);
+
+    if (!ok) {
+        error = path + ":" + std::to_string(line) + ": " + parser.message;
+        return false;
+    }
+    if (read_error) {
+        error = "error reading " + path;
+        return false;
+    }
+    if (parser.indices.empty()) {
+        error = path + ": no faces";
+        return false;
+    }
+    vertices = std::move(parser.vertices);
+    indices = std::move(parser.indices);
+    return true;
+}
@@ -0,0 +1,191 @@
+#ifndef TRIANGLE_MESHH
+#define TRIANGLE_MESHH
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "hitable.h"
+#include "linear_bvh.h"
+
+// The per-ray half of the watertight ray/triangle test (Woop, Benthin and
+// Wald, "Watertight Ray/Triangle Intersection", JCGT 2013). The ray is
+// sheared so it runs along +z from the origin; kz is its largest direction
+// component and kx, ky the other two, swapped if needed to keep the
+// winding. Every triangle the ray meets is transformed the same way.
+struct triangle_ray {
+    int kx, ky, kz;
+    real sx, sy, sz;
+    vec3 origin;
+
+    triangle_ray(const ray& r) : origin(r.origin()) {
+        vec3 d = r.direction();
+        kz = std::fabs(d[0]) > std::fabs(d[1]) ? (std::fabs(d[0]) > std::fabs(d[2]) ? 0 : 2)
+                                               : (std::fabs(d[1]) > std::fabs(d[2]) ? 1 : 2);
+        kx = (kz + 1) % 3;
+        ky = (kx + 1) % 3;
+        if (d[kz] < 0)
+            std::swap(kx, ky);
+        sx = d[kx] / d[kz];
+        sy = d[ky] / d[kz];
+        sz = real(1) / d[kz];
+    }
+};
+
+// The per-triangle half. The edge functions u, v, w of the sheared 2D
+// triangle decide the hit by their signs alone, so a ray through an edge or
+// vertex shared by two triangles hits at least one of them. Any that comes
+// out exactly zero is recomputed in double, since the float product can
+// round to zero on the wrong side. Both faces count as hits; t is in
+// (tmin, tmax) on success.
+inline bool hit_triangle(const triangle_ray& tr, const vec3& p0, const vec3& p1, const vec3& p2,
+                         real tmin, real tmax, real& t) {
+    vec3 a = p0 - tr.origin, b = p1 - tr.origin, c = p2 - tr.origin;
+    real ax = a[tr.kx] - tr.sx*a[tr.kz], ay = a[tr.ky] - tr.sy*a[tr.kz];
+    real bx = b[tr.kx] - tr.sx*b[tr.kz], by = b[tr.ky] - tr.sy*b[tr.kz];
+    real cx = c[tr.kx] - tr.sx*c[tr.kz], cy = c[tr.ky] - tr.sy*c[tr.kz];
+    real u = cx*by - cy*bx;
+    real v = ax*cy - ay*cx;
+    real w = bx*ay - by*ax;
+    if (u == 0 || v == 0 || w == 0) {
+        u = real(double(cx)*double(by) - double(cy)*double(bx));
+        v = real(double(ax)*double(cy) - double(ay)*double(cx));
+        w = real(double(bx)*double(ay) - double(by)*double(ax));
+    }
+    if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+        return false;
+    real det = u + v + w;
+    if (det == 0)
+        return false;
+
+    // Compare t*det against the scaled limits to put off the divide.
+    real scaled = u*(tr.sz*a[tr.kz]) + v*(tr.sz*b[tr.kz]) + w*(tr.sz*c[tr.kz]);
+    if (det > 0 ? (scaled <= tmin*det || scaled >= tmax*det)
+                : (scaled >= tmin*det || scaled <= tmax*det))
+        return false;
+    t = scaled / det;
+    return t > tmin && t < tmax;
+}
+
+// Triangles sharing one vertex buffer and one index buffer (three indices
+// per triangle), with a linear_bvh_node tree of its own over them, so the
+// scene sees the whole mesh as one primitive with one box. The triangles
+// are reordered at build time so each leaf covers a contiguous run.
+//
+// The normal is the geometric one, (p1 - p0) x (p2 - p0) normalized, so it
+// faces out of a closed mesh wound counter-clockwise seen from outside,
+// the way sphere normals face out.
+class triangle_mesh : public hitable {
+    public:
+        triangle_mesh(std::vector<vec3> vertices, std::vector<int32_t> indices, int mat_id, int max_leaf = 4)
+            : vertices(std::move(vertices)), indices(std::move(indices)), mat_id(mat_id) {
+            int n = triangle_count();
+            std::vector<bvh_primitive> prims(n);
+            for (int i = 0; i < n; i++) {
+                const int32_t* tri = &this->indices[3*i];
+                const vec3& p0 = this->vertices[tri[0]];
+                const vec3& p1 = this->vertices[tri[1]];
+                const vec3& p2 = this->vertices[tri[2]];
+                vec3 lo(std::min({ p0[0], p1[0], p2[0] }), std::min({ p0[1], p1[1], p2[1] }), std::min({ p0[2], p1[2], p2[2] }));
+                vec3 hi(std::max({ p0[0], p1[0], p2[0] }), std::max({ p0[1], p1[1], p2[1] }), std::max({ p0[2], p1[2], p2[2] }));
+                prims[i].box = aabb(lo, hi);
+                prims[i].centroid = prims[i].box.centroid();
+                prims[i].index = i;
+            }
+            if (n > 0) {
+                nodes.reserve(2*n);
+                build_linear_bvh(prims, 0, n, nodes, max_leaf);
+            }
+            std::vector<int32_t> ordered(3*n);
+            for (int i = 0; i < n; i++)
+                std::copy_n(&this->indices[3*prims[i].index], 3, &ordered[3*i]);
+            this->indices.swap(ordered);
+        }
+
+        int triangle_count() const { return int(indices.size() / 3); }
+
+        virtual bool hit(const ray& r, real tmin, real tmax, hit_record& rec) const {
+            triangle_ray tr(r);
+            int closest_tri = -1;
+            real closest_t = tmax;
+            traverse_linear_bvh(nodes, r, tmin, tmax, [&](int first, int count, real& closest) {
+                bool hit_anything = false;
+                for (int i = first; i < first + count; i++) {
+                    const int32_t* tri = &indices[3*i];
+                    real t;
+                    if (hit_triangle(tr, vertices[tri[0]], vertices[tri[1]], vertices[tri[2]], tmin, closest, t)) {
+                        closest = closest_t = t;
+                        closest_tri = i;
+                        hit_anything = true;
+                    }
+                }
+                return hit_anything;
+            });
+            if (closest_tri < 0)
+                return false;
+
+            // Only the closest hit needs its point and normal.
+            const int32_t* tri = &indices[3*closest_tri];
+            const vec3& p0 = vertices[tri[0]];
+            rec.t = closest_t;
+            rec.p = r.point_at_parameter(rec.t);
+            rec.normal = unit_vector(cross(vertices[tri[1]] - p0, vertices[tri[2]] - p0));
+            rec.mat_id = mat_id;
+            rec.mapping = UV_NONE;  // meshes carry no texture coordinates
+            return true;
+        }
+
+        virtual aabb bounding_box() const {
+            if (nodes.empty())
+                return aabb();
+            const linear_bvh_node& root = nodes[0];
+            return aabb(vec3(root.bmin[0], root.bmin[1], root.bmin[2]),
+                        vec3(root.bmax[0], root.bmax[1], root.bmax[2]));
+        }
+
+        std::vector<vec3> vertices;
+        std::vector<int32_t> indices;
+        std::vector<linear_bvh_node> nodes;
+        int mat_id;
+};
+
+// A tessellated sphere with single vertices at the poles, wound
+// counter-clockwise seen from outside: 2*slices*(stacks - 1) triangles.
+inline void sphere_mesh(vec3 center, real radius, int slices, int stacks,
+                        std::vector<vec3>& vertices, std::vector<int32_t>& indices) {
+    vertices.clear();
+    indices.clear();
+    vertices.push_back(center + vec3(0, radius, 0));
+    for (int j = 1; j < stacks; j++) {
+        double theta = M_PI * j / stacks;
+        for (int i = 0; i < slices; i++) {
+            double phi = 2 * M_PI * i / slices;
+            vertices.push_back(center + radius*vec3(std::sin(theta)*std::cos(phi), std::cos(theta), -std::sin(theta)*std::sin(phi)));
+        }
+    }
+    vertices.push_back(center - vec3(0, radius, 0));
+
+    int bottom = int(vertices.size()) - 1;
+    auto ring = [slices](int j, int i) { return 1 + (j - 1)*slices + i % slices; };
+    auto triangle = [&](int a, int b, int c) { indices.insert(indices.end(), { a, b, c }); };
+    for (int i = 0; i < slices; i++) {
+        triangle(0, ring(1, i), ring(1, i + 1));
+        for (int j = 1; j < stacks - 1; j++) {
+            triangle(ring(j, i), ring(j + 1, i), ring(j + 1, i + 1));
+            triangle(ring(j, i), ring(j + 1, i + 1), ring(j, i + 1));
+        }
+        triangle(bottom, ring(stacks - 1, i + 1), ring(stacks - 1, i));
+    }
+}
+
+// Reads the vertices and faces of a Wavefront OBJ file, ready to make a
+// triangle_mesh from. The file is streamed through a fixed buffer, so the
+// memory used is the mesh itself. Faces with more than three corners are
+// split into fans and negative (relative) indices are resolved; texture
+// coordinates, normals, groups and materials are skipped. On failure
+// returns false with the reason in error.
+bool read_obj(const std::string& path, std::vector<vec3>& vertices, std::vector<int32_t>& indices,
+              std::string& error);
+
+#endif
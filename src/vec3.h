@@ -4,126 +4,151 @@
 #include <math.h>
     #include <stdlib.h>
     #include <iostream>
+    #include "real.h"
 
-    class vec3 {
+    // vec3_t<T> is the vector template; vec3 is the one the renderer uses,
+    // with T the build's real type.
+    template <typename T>
+    class vec3_t {
     public:
-        vec3() {}
-        vec3(float e0, float e1, float e2) { e[0] = e0; e[1] = e1; e[2] = e2; }
-        inline float x() const { return e[0]; }
-        inline float y() const { return e[1]; }
-        inline float z() const { return e[2]; }
-        inline float r() const { return e[0]; }
-        inline float g() const { return e[1]; }
-        inline float b() const { return e[2]; }
-
-        inline const vec3& operator+() const { return *this; }
-        inline vec3 operator-() const { return vec3(-e[0], -e[1], -e[2]); }
-        inline float operator[](int i) const { return e[i]; }
-        inline float& operator[](int i) { return e[i]; }
-
-        inline vec3& operator+=(const vec3 &v2);
-        inline vec3& operator-=(const vec3 &v2);
-        inline vec3& operator*=(const vec3 &v2);
-        inline vec3& operator/=(const vec3 &v2);
-        inline vec3& operator*=(const float t);
-        inline vec3& operator/=(const float t);
-
-        inline float length() const { return sqrt(e[0]*e[0] + e[1]*e[1] + e[2]*e[2]); }
-        inline float squared_length() const { return e[0]*e[0] + e[1]*e[1] + e[2]*e[2]; }
+        typedef T value_type;
+
+        vec3_t() {}
+        vec3_t(T e0, T e1, T e2) { e[0] = e0; e[1] = e1; e[2] = e2; }
+        inline T x() const { return e[0]; }
+        inline T y() const { return e[1]; }
+        inline T z() const { return e[2]; }
+        inline T r() const { return e[0]; }
+        inline T g() const { return e[1]; }
+        inline T b() const { return e[2]; }
+
+        inline const vec3_t& operator+() const { return *this; }
+        inline vec3_t operator-() const { return vec3_t(-e[0], -e[1], -e[2]); }
+        inline T operator[](int i) const { return e[i]; }
+        inline T& operator[](int i) { return e[i]; }
+
+        inline vec3_t& operator+=(const vec3_t &v2);
+        inline vec3_t& operator-=(const vec3_t &v2);
+        inline vec3_t& operator*=(const vec3_t &v2);
+        inline vec3_t& operator/=(const vec3_t &v2);
+        inline vec3_t& operator*=(const T t);
+        inline vec3_t& operator/=(const T t);
+
+        inline T length() const { return sqrt(e[0]*e[0] + e[1]*e[1] + e[2]*e[2]); }
+        inline T squared_length() const { return e[0]*e[0] + e[1]*e[1] + e[2]*e[2]; }
         inline void make_unit_vector();
 
-        float e[3];
+        T e[3];
     };
-    inline std::istream& operator>>(std::istream &is, vec3 &t) {
+    template <typename T>
+    inline std::istream& operator>>(std::istream &is, vec3_t<T> &t) {
         is >> t.e[0] >> t.e[1] >> t.e[2];
         return is;
     }
 
-    inline std::ostream& operator<<(std::ostream &os, const vec3 &t) {
+    template <typename T>
+    inline std::ostream& operator<<(std::ostream &os, const vec3_t<T> &t) {
         os << t.e[0] << " " << t.e[1] << " " << t.e[2];
         return os;
     }
 
-    inline void vec3::make_unit_vector() {
-        float k = 1.0 / sqrt(e[0]*e[0] + e[1]*e[1] + e[2]*e[2]);
+    template <typename T>
+    inline void vec3_t<T>::make_unit_vector() {
+        T k = 1.0 / sqrt(e[0]*e[0] + e[1]*e[1] + e[2]*e[2]);
         e[0] *= k; e[1] *= k; e[2] *= k;
     }
 
-    inline vec3 operator+(const vec3 &v1, const vec3 &v2) {
-        return vec3(v1.e[0] + v2.e[0], v1.e[1] + v2.e[1], v1.e[2] + v2.e[2]);
+    template <typename T>
+    inline vec3_t<T> operator+(const vec3_t<T> &v1, const vec3_t<T> &v2) {
+        return vec3_t<T>(v1.e[0] + v2.e[0], v1.e[1] + v2.e[1], v1.e[2] + v2.e[2]);
     }
 
-    inline vec3 operator-(const vec3 &v1, const vec3 &v2) {
-        return vec3(v1.e[0] - v2.e[0], v1.e[1] - v2.e[1], v1.e[2] - v2.e[2]);
+    template <typename T>
+    inline vec3_t<T> operator-(const vec3_t<T> &v1, const vec3_t<T> &v2) {
+        return vec3_t<T>(v1.e[0] - v2.e[0], v1.e[1] - v2.e[1], v1.e[2] - v2.e[2]);
     }
 
-    inline vec3 operator*(const vec3 &v1, const vec3 &v2) {
-        return vec3(v1.e[0] * v2.e[0], v1.e[1] * v2.e[1], v1.e[2] * v2.e[2]);
+    template <typename T>
+    inline vec3_t<T> operator*(const vec3_t<T> &v1, const vec3_t<T> &v2) {
+        return vec3_t<T>(v1.e[0] * v2.e[0], v1.e[1] * v2.e[1], v1.e[2] * v2.e[2]);
     }
 
-    inline vec3 operator/(const vec3 &v1, const vec3 &v2) {
-        return vec3(v1.e[0] / v2.e[0], v1.e[1] / v2.e[1], v1.e[2] / v2.e[2]);
+    template <typename T>
+    inline vec3_t<T> operator/(const vec3_t<T> &v1, const vec3_t<T> &v2) {
+        return vec3_t<T>(v1.e[0] / v2.e[0], v1.e[1] / v2.e[1], v1.e[2] / v2.e[2]);
     }
 
-    inline vec3 operator*(float t, const vec3 &v) {
-        return vec3(t*v.e[0], t*v.e[1], t*v.e[2]);
+    // The scalar is a non-deduced value_type, so 2.0*v works for any T.
+    template <typename T>
+    inline vec3_t<T> operator*(typename vec3_t<T>::value_type t, const vec3_t<T> &v) {
+        return vec3_t<T>(t*v.e[0], t*v.e[1], t*v.e[2]);
     }
 
-    inline vec3 operator/(vec3 v, float t) {
-        return vec3(v.e[0]/t, v.e[1]/t, v.e[2]/t);
+    template <typename T>
+    inline vec3_t<T> operator/(vec3_t<T> v, typename vec3_t<T>::value_type t) {
+        return vec3_t<T>(v.e[0]/t, v.e[1]/t, v.e[2]/t);
     }
 
-    inline vec3 operator*(const vec3 &v, float t) {
-        return vec3(t*v.e[0], t*v.e[1], t*v.e[2]);
+    template <typename T>
+    inline vec3_t<T> operator*(const vec3_t<T> &v, typename vec3_t<T>::value_type t) {
+        return vec3_t<T>(t*v.e[0], t*v.e[1], t*v.e[2]);
     }
 
-    inline float dot(const vec3 &v1, const vec3 &v2) {
+    template <typename T>
+    inline T dot(const vec3_t<T> &v1, const vec3_t<T> &v2) {
         return v1.e[0] *v2.e[0] + v1.e[1] *v2.e[1]  + v1.e[2] *v2.e[2];
     }
 
-    inline vec3 cross(const vec3 &v1, const vec3 &v2) {
-        return vec3(v1.e[1] * v2.e[2] - v1.e[2] * v2.e[1],
-                    v1.e[2] * v2.e[0] - v1.e[0] * v2.e[2],
-                    v1.e[0] * v2.e[1] - v1.e[1] * v2.e[0]);
+    template <typename T>
+    inline vec3_t<T> cross(const vec3_t<T> &v1, const vec3_t<T> &v2) {
+        return vec3_t<T>(v1.e[1] * v2.e[2] - v1.e[2] * v2.e[1],
+                         v1.e[2] * v2.e[0] - v1.e[0] * v2.e[2],
+                         v1.e[0] * v2.e[1] - v1.e[1] * v2.e[0]);
     }
 
-    inline vec3& vec3::operator+=(const vec3 &v){
+    template <typename T>
+    inline vec3_t<T>& vec3_t<T>::operator+=(const vec3_t<T> &v){
         e[0]  += v.e[0];
         e[1]  += v.e[1];
         e[2]  += v.e[2];
         return *this;
     }
 
-    inline vec3& vec3::operator*=(const vec3 &v){
+    template <typename T>
+    inline vec3_t<T>& vec3_t<T>::operator*=(const vec3_t<T> &v){
         e[0]  *= v.e[0];
         e[1]  *= v.e[1];
         e[2]  *= v.e[2];
         return *this;
     }
 
-    inline vec3& vec3::operator/=(const vec3 &v){
+    template <typename T>
+    inline vec3_t<T>& vec3_t<T>::operator/=(const vec3_t<T> &v){
         e[0]  /= v.e[0];
         e[1]  /= v.e[1];
         e[2]  /= v.e[2];
         return *this;
     }
 
-    inline vec3& vec3::operator-=(const vec3& v) {
+    template <typename T>
+    inline vec3_t<T>& vec3_t<T>::operator-=(const vec3_t<T>& v) {
         e[0]  -= v.e[0];
         e[1]  -= v.e[1];
         e[2]  -= v.e[2];
         return *this;
     }
 
-    inline vec3& vec3::operator*=(const float t) {
+    template <typename T>
+    inline vec3_t<T>& vec3_t<T>::operator*=(const T t) {
         e[0]  *= t;
         e[1]  *= t;
         e[2]  *= t;
         return *this;
     }
 
-    inline vec3& vec3::operator/=(const float t) {
-        float k = 1.0/t;
+    template <typename T>
+    inline vec3_t<T>& vec3_t<T>::operator/=(const T t) {
+        T k = 1.0/t;
 
         e[0]  *= k;
         e[1]  *= k;
@@ -131,8 +156,18 @@
         return *this;
     }
 
-    inline vec3 unit_vector(vec3 v) {
+    template <typename T>
+    inline vec3_t<T> unit_vector(vec3_t<T> v) {
         return v / v.length();
     }
 
-#endif
\ No newline at end of file
+// Building with VEC3_SIMD swaps in a vec3 held in a 16 byte SSE register
+// (see vec3_sse.h). Without SSE2, or in a double precision build, the
+// define is ignored.
+#if defined(VEC3_SIMD) && defined(__SSE2__) && !defined(REAL_DOUBLE)
+#include "vec3_sse.h"
+#else
+    typedef vec3_t<real> vec3;
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+// vec3 backed by one SSE register, used when the build defines VEC3_SIMD.
+// Included by vec3.h only; the interface is the same as the scalar vec3's.
+//
+// Lanes are x, y, z, w. w carries no meaning; every operation keeps it
+// finite where it can, and nothing reads it back. dot() adds the products
+// in the same order as the scalar version, so the two layouts agree on
+// everything except unit_vector, which uses a reciprocal square root
+// estimate refined by one Newton step (about 23 good bits) instead of a
+// sqrt and a divide.
+
+#include <immintrin.h>
+
+    class alignas(16) vec3 {
+    public:
+        typedef float value_type;
+
+        vec3() {}
+        vec3(float e0, float e1, float e2) : m(_mm_set_ps(0, e2, e1, e0)) {}
+        explicit vec3(__m128 m) : m(m) {}
+        inline float x() const { return e[0]; }
+        inline float y() const { return e[1]; }
+        inline float z() const { return e[2]; }
+        inline float r() const { return e[0]; }
+        inline float g() const { return e[1]; }
+        inline float b() const { return e[2]; }
+
+        inline const vec3& operator+() const { return *this; }
+        inline vec3 operator-() const { return vec3(_mm_sub_ps(_mm_setzero_ps(), m)); }
+        inline float operator[](int i) const { return e[i]; }
+        inline float& operator[](int i) { return e[i]; }
+
+        inline vec3& operator+=(const vec3 &v2) { m = _mm_add_ps(m, v2.m); return *this; }
+        inline vec3& operator-=(const vec3 &v2) { m = _mm_sub_ps(m, v2.m); return *this; }
+        inline vec3& operator*=(const vec3 &v2) { m = _mm_mul_ps(m, v2.m); return *this; }
+        inline vec3& operator/=(const vec3 &v2) { m = _mm_div_ps(m, v2.m); return *this; }
+        inline vec3& operator*=(const float t) { m = _mm_mul_ps(m, _mm_set1_ps(t)); return *this; }
+        inline vec3& operator/=(const float t) { m = _mm_mul_ps(m, _mm_set1_ps(1.0f / t)); return *this; }
+
+        inline float length() const;
+        inline float squared_length() const;
+        inline void make_unit_vector();
+
+        union {
+            __m128 m;
+            float e[4];
+        };
+    };
+
+    // x*x' + y*y' + z*z' in lane 0, summed left to right like the scalar dot.
+    inline __m128 vec3_dot_ss(__m128 a, __m128 b) {
+        __m128 p = _mm_mul_ps(a, b);
+        __m128 s = _mm_add_ss(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_add_ss(s, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)));
+    }
+
+    inline std::istream& operator>>(std::istream &is, vec3 &t) {
+        is >> t.e[0] >> t.e[1] >> t.e[2];
+        return is;
+    }
+
+    inline std::ostream& operator<<(std::ostream &os, const vec3 &t) {
+        os << t.e[0] << " " << t.e[1] << " " << t.e[2];
+        return os;
+    }
+
+    inline float vec3::length() const { return _mm_cvtss_f32(_mm_sqrt_ss(vec3_dot_ss(m, m))); }
+    inline float vec3::squared_length() const { return _mm_cvtss_f32(vec3_dot_ss(m, m)); }
+
+    inline vec3 operator+(const vec3 &v1, const vec3 &v2) { return vec3(_mm_add_ps(v1.m, v2.m)); }
+    inline vec3 operator-(const vec3 &v1, const vec3 &v2) { return vec3(_mm_sub_ps(v1.m, v2.m)); }
+    inline vec3 operator*(const vec3 &v1, const vec3 &v2) { return vec3(_mm_mul_ps(v1.m, v2.m)); }
+    inline vec3 operator/(const vec3 &v1, const vec3 &v2) { return vec3(_mm_div_ps(v1.m, v2.m)); }
+    inline vec3 operator*(float t, const vec3 &v) { return vec3(_mm_mul_ps(_mm_set1_ps(t), v.m)); }
+    inline vec3 operator*(const vec3 &v, float t) { return vec3(_mm_mul_ps(v.m, _mm_set1_ps(t))); }
+    inline vec3 operator/(vec3 v, float t) { return vec3(_mm_div_ps(v.m, _mm_set1_ps(t))); }
+
+    inline float dot(const vec3 &v1, const vec3 &v2) {
+        return _mm_cvtss_f32(vec3_dot_ss(v1.m, v2.m));
+    }
+
+    inline vec3 cross(const vec3 &v1, const vec3 &v2) {
+        // (y z x) * (z x y) - (z x y) * (y z x)
+        __m128 a_yzx = _mm_shuffle_ps(v1.m, v1.m, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 b_zxy = _mm_shuffle_ps(v2.m, v2.m, _MM_SHUFFLE(3, 1, 0, 2));
+        __m128 a_zxy = _mm_shuffle_ps(v1.m, v1.m, _MM_SHUFFLE(3, 1, 0, 2));
+        __m128 b_yzx = _mm_shuffle_ps(v2.m, v2.m, _MM_SHUFFLE(3, 0, 2, 1));
+        return vec3(_mm_sub_ps(_mm_mul_ps(a_yzx, b_zxy), _mm_mul_ps(a_zxy, b_yzx)));
+    }
+
+    // 1/sqrt(x) in every lane of the result: the hardware estimate (12 bits)
+    // plus one Newton-Raphson step, y' = y * (1.5 - 0.5 * x * y * y).
+    inline __m128 vec3_rsqrt(__m128 x) {
+        __m128 y = _mm_rsqrt_ps(x);
+        __m128 half_x = _mm_mul_ps(_mm_set1_ps(0.5f), x);
+        return _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(half_x, _mm_mul_ps(y, y))));
+    }
+
+    inline vec3 unit_vector(vec3 v) {
+        __m128 d = vec3_dot_ss(v.m, v.m);
+        return vec3(_mm_mul_ps(v.m, vec3_rsqrt(_mm_shuffle_ps(d, d, 0))));
+    }
+
+    inline void vec3::make_unit_vector() {
+        *this = unit_vector(*this);
+    }
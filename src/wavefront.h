@@ -0,0 +1,137 @@
+#ifndef WAVEFRONTH
+#define WAVEFRONTH
+
+#include <vector>
+#include "camera.h"
+#include "integrator.h"
+#include "random.h"
+#include "tile_renderer.h"
+
+// One path in flight. Each path carries its own RNG stream, so the result
+// does not depend on the order the queues happen to process paths in.
+struct wavefront_path {
+    ray r;
+    vec3 throughput;
+    hit_record rec;
+    rng_state rng;
+    ray_cone cone;
+    int pixel;  // index into the caller's radiance array
+    int depth;
+};
+
+// Traces a batch of paths breadth first. Each round, the extend stage
+// intersects every live path with the scene. Then the shade stage buckets
+// the hits by material type and scatters each bucket in turn with that
+// type's scatter function called directly, so one material's code and data
+// stay hot across many paths and no per-hit dispatch is left. Survivors go back in
+// the extend queue for the next bounce.
+class wavefront_integrator {
+    public:
+        wavefront_integrator(const hitable *world, const material_table& materials, bool roulette = true)
+            : world(world), materials(materials), roulette(roulette) {}
+
+        // Runs every path to completion, adding each one's radiance to
+        // radiance[path.pixel]. paths is consumed.
+        void trace(std::vector<wavefront_path>& paths, vec3 *radiance) {
+            extend_queue.swap(paths);
+            paths.clear();
+            while (!extend_queue.empty()) {
+                extend(radiance);
+                shade();
+            }
+        }
+
+    private:
+        void extend(vec3 *radiance) {
+            path_stats& stats = thread_path_stats();
+            for (int m = 0; m < MAT_TYPE_COUNT; m++)
+                shade_queue[m].clear();
+            for (wavefront_path& p : extend_queue) {
+                if (world->hit(p.r, 0.001, MAXFLOAT, p.rec)) {
+                    p.cone.reach(p.r, p.rec);
+                    shade_queue[materials[p.rec.mat_id].type].push_back(p);
+                } else {
+                    radiance[p.pixel] += p.throughput*sky(p.r);
+                    stats.record(p.depth, PATH_ESCAPED);
+                }
+            }
+            extend_queue.clear();
+        }
+
+        void shade() {
+            shade_bucket(MAT_LAMBERTIAN, lambertian_scatter);
+            shade_bucket(MAT_METAL, metal_scatter);
+            shade_bucket(MAT_DIELECTRIC, dielectric_scatter);
+        }
+
+        template <typename Scatter>
+        void shade_bucket(material_type type, Scatter scatter) {
+            std::vector<wavefront_path>& bucket = shade_queue[type];
+            rng_state& thread_rng = random_state();
+            path_stats& stats = thread_path_stats();
+            for (wavefront_path& p : bucket) {
+                if (p.depth >= max_depth) {
+                    stats.record(p.depth, PATH_MAX_DEPTH);
+                    continue;
+                }
+                ray scattered;
+                vec3 attenuation;
+                // scatter draws from the thread's generator, so lend it
+                // this path's stream for the call.
+                thread_rng = p.rng;
+                bool alive = scatter(materials[p.rec.mat_id], p.r, p.rec, attenuation, scattered);
+                p.rng = thread_rng;
+                if (!alive) {
+                    stats.record(p.depth, PATH_ABSORBED);
+                    continue;
+                }
+                p.cone.bounce(type);
+                p.throughput *= attenuation;
+                p.r = scattered;
+                p.depth++;
+                if (roulette && p.depth >= roulette_min_depth
+                    && !survive_roulette(p.throughput, rng_double(p.rng))) {
+                    stats.record(p.depth, PATH_ROULETTE);
+                    continue;
+                }
+                extend_queue.push_back(p);
+            }
+        }
+
+        const hitable *world;
+        const material_table& materials;
+        bool roulette;
+        std::vector<wavefront_path> extend_queue;
+        std::vector<wavefront_path> shade_queue[MAT_TYPE_COUNT];
+};
+
+// Builds ns jittered camera paths for every pixel of t. Pixel indices are
+// relative to the tile, row by row. Sample s of pixel (i, j) gets its own
+// stream derived from (seed, i, j, s).
+inline std::vector<wavefront_path> camera_paths(const camera& cam, const tile& t, int nx, int ny,
+                                                int ns, uint64_t seed) {
+    real spread = cam.pixel_spread(ny);
+    std::vector<wavefront_path> paths;
+    paths.reserve((t.x1 - t.x0)*(t.y1 - t.y0)*ns);
+    int tile_width = t.x1 - t.x0;
+    for (int j = t.y0; j < t.y1; j++) {
+        for (int i = t.x0; i < t.x1; i++) {
+            uint64_t pixel = pixel_seed(seed, i, j);
+            for (int s = 0; s < ns; s++) {
+                wavefront_path p;
+                p.rng = make_rng(pixel + s);
+                float u = float(i + rng_double(p.rng)) / float(nx);
+                float v = float(j + rng_double(p.rng)) / float(ny);
+                p.r = cam.get_ray(u, v);
+                p.throughput = vec3(1, 1, 1);
+                p.cone = ray_cone{ 0, spread };
+                p.pixel = (j - t.y0)*tile_width + (i - t.x0);
+                p.depth = 0;
+                paths.push_back(p);
+            }
+        }
+    }
+    return paths;
+}
+
+#endif